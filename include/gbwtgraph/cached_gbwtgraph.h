@@ -1,6 +1,7 @@
 #ifndef GBWTGRAPH_CACHED_GBWTGRAPH_H
 #define GBWTGRAPH_CACHED_GBWTGRAPH_H
 
+#include <unordered_set>
 #include <vector>
 
 #include <gbwtgraph/gbwtgraph.h>
@@ -17,14 +18,15 @@ namespace gbwtgraph
 /*
   A variant of GBWTGraph intended for algorithms that repeatedly access the edges
   of a small subgraph. Provides an easy way of using the cached GBWTGraph interface
-  in HandleGraph algorithms.
+  in HandleGraph algorithms. The PathHandleGraph interface walks the named paths
+  through the same cache.
   NOTE: The cache is not thread-safe. Use a separate CachedGBWTGraph for each
   thread.
   NOTE: For performance reasons, this implementations replicates much of GBWTGraph
   functionality instead of calling it through virtual functions.
 */
 
-class CachedGBWTGraph : public HandleGraph
+class CachedGBWTGraph : public PathHandleGraph
 {
 public:
   CachedGBWTGraph();
@@ -41,6 +43,14 @@ public:
   const GBWTGraph* graph;
   gbwt::CachedGBWT cache;
 
+  // Decompress the GBWT records for both orientations of the given nodes in node
+  // order and insert them into the cache, so that a local algorithm on the subgraph
+  // does not interleave decompression with its own work. Nodes that do not exist
+  // are ignored. Returns the number of oriented nodes visited, including those
+  // whose records were already in the cache.
+  size_t prewarm(const std::vector<nid_t>& nodes);
+  size_t prewarm(const std::unordered_set<nid_t>& nodes);
+
 //------------------------------------------------------------------------------
 
   /*
@@ -120,6 +130,118 @@ public:
   // handle to the right handle.
   virtual bool has_edge(const handle_t& left, const handle_t& right) const;
 
+  // Return the total number of edges in the graph. Uses cached statistics.
+  virtual size_t get_edge_count() const;
+
+  // Return the total length of node sequences in the graph. Uses cached statistics.
+  virtual size_t get_total_length() const;
+
+//------------------------------------------------------------------------------
+
+  /*
+    PathHandleGraph interface. Path navigation and the steps on a handle use the
+    cache, while the path metadata comes from the underlying GBWTGraph.
+  */
+
+public:
+
+  /// Returns the number of paths stored in the graph
+  virtual size_t get_path_count() const;
+
+  /// Determine if a path name exists and is legal to get a path handle for.
+  virtual bool has_path(const std::string& path_name) const;
+
+  /// Look up the path handle for the given path name.
+  /// The path with that name must exist.
+  virtual path_handle_t get_path_handle(const std::string& path_name) const;
+
+  /// Look up the name of a path from a handle to it
+  virtual std::string get_path_name(const path_handle_t& path_handle) const;
+
+  /// Look up whether a path is circular
+  virtual bool get_is_circular(const path_handle_t& path_handle) const;
+
+  /// Returns the number of node steps in the path
+  virtual size_t get_step_count(const path_handle_t& path_handle) const;
+
+  /// Returns the number of node steps on a handle
+  virtual size_t get_step_count(const handle_t& handle) const;
+
+  /// Get a node handle (node ID and orientation) from a handle to an step on a path
+  virtual handle_t get_handle_of_step(const step_handle_t& step_handle) const;
+
+  /// Returns a handle to the path that an step is on
+  virtual path_handle_t get_path_handle_of_step(const step_handle_t& step_handle) const;
+
+  /// Get a handle to the first step, or `path_end()` if the path is empty.
+  virtual step_handle_t path_begin(const path_handle_t& path_handle) const;
+
+  /// Get a handle to a fictitious position past the end of a path.
+  virtual step_handle_t path_end(const path_handle_t& path_handle) const;
+
+  /// Get a handle to the last step, or `path_front_end()` if the path is empty.
+  virtual step_handle_t path_back(const path_handle_t& path_handle) const;
+
+  /// Get a handle to a fictitious position before the beginning of a path.
+  virtual step_handle_t path_front_end(const path_handle_t& path_handle) const;
+
+  /// Returns true if the step is not the last step in a non-circular path.
+  virtual bool has_next_step(const step_handle_t& step_handle) const;
+
+  /// Returns true if the step is not the first step in a non-circular path.
+  virtual bool has_previous_step(const step_handle_t& step_handle) const;
+
+  /// Returns a handle to the next step on the path. Uses the cache.
+  virtual step_handle_t get_next_step(const step_handle_t& step_handle) const;
+
+  /// Returns a handle to the previous step on the path. Uses the cache.
+  virtual step_handle_t get_previous_step(const step_handle_t& step_handle) const;
+
+  using PathHandleGraph::for_each_path_handle;
+  using PathHandleGraph::for_each_step_on_handle;
+
+protected:
+
+  /// Execute a function on each path in the graph. If it returns false, stop
+  /// iteration. Returns true if we finished and false if we stopped early.
+  virtual bool for_each_path_handle_impl(const std::function<bool(const path_handle_t&)>& iteratee) const;
+
+  /// Execute a function on each step of a handle in any path. If it
+  /// returns false, stop iteration. Returns true if we finished and false if
+  /// we stopped early.
+  virtual bool for_each_step_on_handle_impl(const handle_t& handle,
+      const std::function<bool(const step_handle_t&)>& iteratee) const;
+
+//------------------------------------------------------------------------------
+
+  /*
+    PathMetadata interface. Delegated to the underlying GBWTGraph.
+  */
+
+public:
+
+  virtual PathSense get_sense(const path_handle_t& handle) const { return this->graph->get_sense(handle); }
+  virtual std::string get_sample_name(const path_handle_t& handle) const { return this->graph->get_sample_name(handle); }
+  virtual std::string get_locus_name(const path_handle_t& handle) const { return this->graph->get_locus_name(handle); }
+  virtual size_t get_haplotype(const path_handle_t& handle) const { return this->graph->get_haplotype(handle); }
+  virtual size_t get_phase_block(const path_handle_t& handle) const { return this->graph->get_phase_block(handle); }
+  virtual subrange_t get_subrange(const path_handle_t& handle) const { return this->graph->get_subrange(handle); }
+
+protected:
+
+  virtual bool for_each_path_matching_impl(const std::unordered_set<PathSense>* senses,
+                                           const std::unordered_set<std::string>* samples,
+                                           const std::unordered_set<std::string>* loci,
+                                           const std::function<bool(const path_handle_t&)>& iteratee) const
+  {
+    return this->graph->for_each_path_matching_impl(senses, samples, loci, iteratee);
+  }
+
+  virtual bool for_each_step_of_sense_impl(const handle_t& visited, const PathSense& sense, const std::function<bool(const step_handle_t&)>& iteratee) const
+  {
+    return this->graph->for_each_step_of_sense_impl(visited, sense, iteratee);
+  }
+
 //------------------------------------------------------------------------------
 
   /*
@@ -173,7 +295,27 @@ public:
   bool follow_paths(gbwt::BidirectionalState state, bool backward,
                     const std::function<bool(const gbwt::BidirectionalState&)>& iteratee) const
   {
-    return this->graph->follow_paths(this->cache, state, backward, iteratee); 
+    return this->graph->follow_paths(this->cache, state, backward, iteratee);
+  }
+
+  // Template versions of `follow_edges()` and `follow_paths()` that can inline the
+  // iteratee. See the template interface in GBWTGraph.
+  template<class Iteratee>
+  bool for_each_successor(const handle_t& handle, bool go_left, Iteratee&& iteratee) const
+  {
+    return this->graph->for_each_successor(this->cache, handle, go_left, iteratee);
+  }
+
+  template<class Iteratee>
+  bool for_each_extension(gbwt::SearchState state, Iteratee&& iteratee) const
+  {
+    return this->graph->for_each_extension(this->cache, state, iteratee);
+  }
+
+  template<class Iteratee>
+  bool for_each_extension(gbwt::BidirectionalState state, bool backward, Iteratee&& iteratee) const
+  {
+    return this->graph->for_each_extension(this->cache, state, backward, iteratee);
   }
 
 //------------------------------------------------------------------------------
@@ -184,6 +326,16 @@ private:
 
 //------------------------------------------------------------------------------
 
+/*
+  Create a CachedGBWTGraph for each region and prewarm it with the nodes of the
+  region. The regions are processed in parallel, and each of the returned graphs
+  can then be used by a separate thread.
+  The number of threads can be set through OMP.
+*/
+std::vector<CachedGBWTGraph> prewarmed_graphs(const GBWTGraph& graph, const std::vector<std::vector<nid_t>>& regions);
+
+//------------------------------------------------------------------------------
+
 } // namespace gbwtgraph
 
 #endif // GBWTGRAPH_CACHED_GBWTGRAPH_H
@@ -2,6 +2,7 @@
 #define GBWTGRAPH_GBWTGRAPH_H
 
 #include <vector>
+#include <limits>
 #include <map>
 
 #include <gbwt/cached_gbwt.h>
@@ -99,11 +100,47 @@ public:
     bool operator!=(const Header& another) const { return !(this->operator==(another)); }
   };
 
+  // Summary statistics computed in parallel when the graph is built or loaded.
+  // They are not serialized, as they can be derived from the GBWT and the sequences.
+  struct Statistics
+  {
+    size_t edges = 0;
+    size_t total_length = 0; // In the forward orientation.
+    size_t min_length = 0, max_length = 0;
+
+    bool operator==(const Statistics& another) const
+    {
+      return (this->edges == another.edges && this->total_length == another.total_length &&
+              this->min_length == another.min_length && this->max_length == another.max_length);
+    }
+    bool operator!=(const Statistics& another) const { return !(this->operator==(another)); }
+  };
+
+  // Optional node record for hot accessors. The records are stored by node offset,
+  // so that existence, sequence location, and degree are in the same cache line.
+  struct NodeRecord
+  {
+    std::uint64_t offset;    // Offset in the strings of the active sequence store.
+    std::uint32_t length;
+    std::uint16_t outdegree; // In this orientation, or `DEGREE_UNKNOWN`.
+    std::uint8_t  present;
+    std::uint8_t  padding;
+  };
+
+  constexpr static std::uint16_t DEGREE_UNKNOWN = 0xFFFF;
+
   const gbwt::GBWT* index;
 
-  Header            header;
-  gbwt::StringArray sequences;
-  sdsl::bit_vector  real_nodes;
+  Header                  header;
+  gbwt::StringArray       sequences;
+  sdsl::bit_vector        real_nodes;
+  Statistics              statistics;
+  std::vector<NodeRecord> node_records; // Not serialized.
+
+  // Optional deduplicated sequence store. When it exists, `sequences` is empty, and
+  // the sequence at node offset `i` is `unique_sequences[sequence_ids[i]]`.
+  gbwt::StringArray       unique_sequences; // Not serialized.
+  sdsl::int_vector<0>     sequence_ids;     // Not serialized.
 
   // Segment to node translation. Node `v` maps to segment `node_to_segment.predecessor(v)->first`.
   gbwt::StringArray segments;
@@ -204,6 +241,12 @@ public:
   // handle to the right handle.
   virtual bool has_edge(const handle_t& left, const handle_t& right) const;
 
+  // Return the total number of edges in the graph. Uses cached statistics.
+  virtual size_t get_edge_count() const;
+
+  // Return the total length of node sequences in the graph. Uses cached statistics.
+  virtual size_t get_total_length() const;
+
 //------------------------------------------------------------------------------
 
   /*
@@ -497,8 +540,23 @@ public:
     return for_each_link_impl(handlegraph::BoolReturningWrapper<Iteratee>::wrap(iteratee), parallel);
   }
 
+  /// Calls `iteratee` with each edge in the canonical orientation. Stops early if
+  /// the call returns `false`. Returns false if iteration was stopped, and true
+  /// otherwise. This hides the generic HandleGraph version, which decodes the GBWT
+  /// records separately for each `follow_edges()` call.
+  /// The parallel version stops early on a best-effort basis.
+  template<typename Iteratee>
+  bool for_each_edge(const Iteratee& iteratee, bool parallel = false) const {
+    return for_each_edge_impl(handlegraph::BoolReturningWrapper<Iteratee>::wrap(iteratee), parallel);
+  }
+
 protected:
 
+  // Calls `iteratee` with each edge in the canonical orientation by walking the GBWT
+  // records of both orientations of each node once. Stops early if the call returns
+  // `false`. Parallel iteration uses node ranges with a cache for each thread.
+  bool for_each_edge_impl(const std::function<bool(const edge_t&)>& iteratee, bool parallel) const;
+
   // Calls `iteratee` with each segment name and the semiopen interval of node ids
   // corresponding to it. Stops early if the call returns `false`.
   // In GBWTGraph, the segments are visited in sorted order by node ids.
@@ -544,6 +602,33 @@ public:
   // Returns the size of the serialized structure in elements.
   size_t simple_sds_size() const;
 
+  // Advise the kernel to use transparent huge pages for the node sequences and
+  // `real_nodes`. This reduces TLB misses in random access to large graphs.
+  // Returns the number of bytes covered by the advice.
+  size_t advise_huge_pages() const;
+
+  // Build the optional node records using multiple threads. When the records
+  // exist, `has_node()`, `get_degree()`, and the sequence accessors use them
+  // instead of `real_nodes`, the string array index, and the GBWT.
+  // The records are cleared when the graph is loaded or the GBWT is changed.
+  // Returns false and leaves the records empty if a node is too long.
+  // The number of threads can be set through OMP.
+  bool build_node_records();
+
+  void clear_node_records() { std::vector<NodeRecord>().swap(this->node_records); }
+
+  bool has_node_records() const { return !(this->node_records.empty()); }
+
+  // Replace the sequence store with a deduplicated store, where identical node
+  // sequences (in either orientation) share the same slot. The sequences are hashed
+  // in parallel. Serialization writes the sequences in the usual format, and the
+  // store must be deduplicated again after loading the graph.
+  // Returns the number of distinct sequences.
+  // The number of threads can be set through OMP.
+  size_t deduplicate_sequences();
+
+  bool has_deduplicated_sequences() const { return !(this->sequence_ids.empty()); }
+
   // Convert gbwt::node_type to handle_t.
   static handle_t node_to_handle(gbwt::node_type node) { return handlegraph::as_handle(node); }
 
@@ -553,12 +638,32 @@ public:
   // Get node sequence as a pointer and length.
   view_type get_sequence_view(const handle_t& handle) const;
 
+  // Return the length of the shortest / longest node, or 0 if the graph is empty.
+  size_t min_node_length() const { return this->statistics.min_length; }
+  size_t max_node_length() const { return this->statistics.max_length; }
+
   // Determine if the node sequence starts with the given character.
   bool starts_with(const handle_t& handle, char c) const;
 
   // Determine if the node sequence ends with the given character.
   bool ends_with(const handle_t& handle, char c) const;
 
+  // The label of a walk starts at `offset` in the first handle and contains at most
+  // `length` bases. Returns the length of the label.
+  size_t label_length(const std::vector<handle_t>& walk, size_t offset = 0, size_t length = std::numeric_limits<size_t>::max()) const;
+
+  // Write the label of the walk into the buffer without allocating memory. The buffer
+  // must have space for `label_length()` characters. Returns the number of characters
+  // written.
+  size_t write_label(const std::vector<handle_t>& walk, char* buffer, size_t offset = 0, size_t length = std::numeric_limits<size_t>::max()) const;
+
+  // Write the labels of the walks one after another into the arena, which is resized
+  // once. If `bounds` is non-empty, it contains (offset, length) for each walk.
+  // Returns the starting positions of the labels in the arena, followed by the
+  // total length. The number of threads can be set through OMP.
+  std::vector<size_t> write_labels(const std::vector<std::vector<handle_t>>& walks, const std::vector<std::pair<size_t, size_t>>& bounds,
+                                   std::string& arena, bool parallel = false) const;
+
   // Convert handle_t to gbwt::SearchState.
   // Note that the state may be empty if the handle does not correspond to a real node.
   gbwt::SearchState get_state(const handle_t& handle) const { return this->index->find(handle_to_node(handle)); }
@@ -643,6 +748,90 @@ public:
   bool cached_follow_edges(const gbwt::CachedGBWT& cache, const handle_t& handle, bool go_left,
                            const std::function<bool(const handle_t&)>& iteratee) const;
 
+//------------------------------------------------------------------------------
+
+  /*
+    Template interface for inner loops. These are equivalent to the corresponding
+    functions above, but the iteratee can be any callable, and the compiler can inline
+    both the iteratee and the GBWT record walk. The iteratee returns false to stop.
+  */
+
+  // Call iteratee(handle) for each successor (go_left = false) or predecessor
+  // (go_left = true) of the handle. Equivalent to `cached_follow_edges()`.
+  template<class Iteratee>
+  bool for_each_successor(const gbwt::CachedGBWT& cache, const handle_t& handle, bool go_left, Iteratee&& iteratee) const
+  {
+    // Incoming edges correspond to the outgoing edges of the reverse node.
+    gbwt::node_type curr = handle_to_node(handle);
+    if(go_left) { curr = gbwt::Node::reverse(curr); }
+    gbwt::size_type cache_index = cache.findRecord(curr);
+    for(gbwt::rank_type outrank = 0; outrank < cache.outdegree(cache_index); outrank++)
+    {
+      gbwt::node_type next = cache.successor(cache_index, outrank);
+      if(next == gbwt::ENDMARKER) { continue; }
+      if(go_left) { next = gbwt::Node::reverse(next); }
+      if(!iteratee(node_to_handle(next))) { return false; }
+    }
+    return true;
+  }
+
+  // Call iteratee(next_state) for each non-empty successor state of the state.
+  // Equivalent to `follow_paths()`.
+  template<class Iteratee>
+  bool for_each_extension(const gbwt::CachedGBWT& cache, gbwt::SearchState state, Iteratee&& iteratee) const
+  {
+    gbwt::size_type cache_index = cache.findRecord(state.node);
+    for(gbwt::rank_type outrank = 0; outrank < cache.outdegree(cache_index); outrank++)
+    {
+      if(cache.successor(cache_index, outrank) == gbwt::ENDMARKER) { continue; }
+      gbwt::SearchState next_state = cache.cachedExtend(state, cache_index, outrank);
+      if(next_state.empty()) { continue; }
+      if(!iteratee(next_state)) { return false; }
+    }
+    return true;
+  }
+
+  // Call iteratee(next_state) for each non-empty predecessor/successor state of the
+  // state. Equivalent to `follow_paths()`.
+  template<class Iteratee>
+  bool for_each_extension(const gbwt::CachedGBWT& cache, gbwt::BidirectionalState state, bool backward, Iteratee&& iteratee) const
+  {
+    gbwt::size_type cache_index = cache.findRecord(backward ? state.backward.node : state.forward.node);
+    for(gbwt::rank_type outrank = 0; outrank < cache.outdegree(cache_index); outrank++)
+    {
+      if(cache.successor(cache_index, outrank) == gbwt::ENDMARKER) { continue; }
+      gbwt::BidirectionalState next_state = (backward ? cache.cachedExtendBackward(state, cache_index, outrank) : cache.cachedExtendForward(state, cache_index, outrank));
+      if(next_state.empty()) { continue; }
+      if(!iteratee(next_state)) { return false; }
+    }
+    return true;
+  }
+
+  // Call iteratee(handle) for the forward orientation of each node. Equivalent to
+  // `for_each_handle()`. The parallel version does not stop early.
+  template<class Iteratee>
+  bool for_each_node(Iteratee&& iteratee, bool parallel = false) const
+  {
+    if(parallel)
+    {
+      #pragma omp parallel for schedule(dynamic, CHUNK_SIZE)
+      for(gbwt::node_type node = this->index->firstNode(); node < this->index->sigma(); node += 2)
+      {
+        if(!(this->real_nodes[this->node_offset(node) / 2])) { continue; }
+        iteratee(node_to_handle(node));
+      }
+    }
+    else
+    {
+      for(gbwt::node_type node = this->index->firstNode(); node < this->index->sigma(); node += 2)
+      {
+        if(!(this->real_nodes[this->node_offset(node) / 2])) { continue; }
+        if(!iteratee(node_to_handle(node))) { return false; }
+      }
+    }
+    return true;
+  }
+
 //------------------------------------------------------------------------------
 
 private:
@@ -651,6 +840,9 @@ private:
   // Construction helpers.
   void determine_real_nodes();
   void cache_named_paths();
+  void compute_statistics(); // Requires the GBWT, the sequences, and `real_nodes`.
+  void use_gbwt(const gbwt::GBWT& gbwt_index); // set_gbwt() without the statistics.
+  bool matches_gbwt() const; // The GBWT node range matches the sequences and `real_nodes`.
 
   void copy(const GBWTGraph& source);
 
@@ -669,6 +861,45 @@ private:
 
   size_t node_offset(gbwt::node_type node) const { return node - this->index->firstNode(); }
   size_t node_offset(const handle_t& handle) const { return this->node_offset(handle_to_node(handle)); }
+
+  // Number of node offsets in the active sequence store.
+  size_t stored_sequences() const
+  {
+    return (this->has_deduplicated_sequences() ? this->sequence_ids.size() : this->sequences.size());
+  }
+
+  // Sequence at the given node offset in the active sequence store.
+  view_type stored_view(size_t offset) const
+  {
+    if(this->has_deduplicated_sequences()) { return this->unique_sequences.view(this->sequence_ids[offset]); }
+    return this->sequences.view(offset);
+  }
+
+  size_t stored_length(size_t offset) const
+  {
+    if(this->has_deduplicated_sequences()) { return this->unique_sequences.length(this->sequence_ids[offset]); }
+    return this->sequences.length(offset);
+  }
+
+  // Total length of the sequences in node offsets [start, limit).
+  size_t stored_length(size_t start, size_t limit) const;
+
+  const char* stored_data() const
+  {
+    if(this->has_deduplicated_sequences()) { return this->unique_sequences.strings.data(); }
+    return this->sequences.strings.data();
+  }
+
+  // Sequence at the given node offset using the node records if they exist.
+  view_type node_view(size_t offset) const
+  {
+    if(this->has_node_records())
+    {
+      const NodeRecord& record = this->node_records[offset];
+      return view_type(this->stored_data() + record.offset, record.length);
+    }
+    return this->stored_view(offset);
+  }
 };
 
 //------------------------------------------------------------------------------
@@ -684,6 +915,16 @@ void for_each_haplotype_window(const GBWTGraph& graph, size_t window_size,
                                const std::function<void(const std::vector<handle_t>&, const std::string&)>& lambda,
                                bool parallel);
 
+/*
+  As above, but the lambda also receives the GBWT search state at the end of the window.
+  The size of the state is the number of haplotypes consistent with the window in
+  the orientation of the window. Windows starting from the same node in the same
+  orientation are disjoint in terms of the haplotypes they cover.
+*/
+void for_each_haplotype_window(const GBWTGraph& graph, size_t window_size,
+                               const std::function<void(const std::vector<handle_t>&, const std::string&, const gbwt::SearchState&)>& lambda,
+                               bool parallel);
+
 //------------------------------------------------------------------------------
 
 } // namespace gbwtgraph
@@ -104,7 +104,8 @@ public:
   void serialize_to_files(const std::string& gbwt_name, const std::string& graph_name, bool simple_sds_graph = false) const;
 
   // Loads the GBWT (simple-sds format) and the GBWTGraph from separate files.
-  // Graph format is libhandlegraph / SDSL; the simple-sds format cannot be read.
+  // The graph file is memory-mapped, and its format (libhandlegraph / SDSL or
+  // simple-sds) is detected from the header.
   void load_from_files(const std::string& gbwt_name, const std::string& graph_name);
 
 private:
@@ -3,6 +3,7 @@
 
 #include <memory>
 #include <list>
+#include <unordered_set>
 
 #include <gbwt/dynamic_gbwt.h>
 
@@ -45,6 +46,20 @@ struct GFAParsingParameters
   // much larger than `N`, and hence it may be useful to set the batch size manually.
   bool automatic_batch_size = true;
 
+  // Renumber the nodes for locality. Within each weakly connected component, the
+  // segments are ordered by a topological order of the nodes, or by breadth-first
+  // search if the component is cyclic. The segments then get consecutive node ids
+  // in that order, and the mapping is stored in the segment translation.
+  bool renumber_nodes = false;
+
+  // Merge maximal non-branching chains of nodes that all paths traverse in the same
+  // way, as long as the merged nodes are at most `max_node_length` bp. The merged
+  // node keeps the identifier of the first node in the chain. The chains are found
+  // and merged in parallel for each job. A segment translation cannot map a node
+  // to several segments, so unchopping is only possible if the graph is built
+  // without a translation. Otherwise the construction throws `std::runtime_error`.
+  bool unchop_chains = false;
+
   bool show_progress = false;
 
   /*
@@ -121,6 +136,33 @@ struct GFAExtractionParameters
 
 //------------------------------------------------------------------------------
 
+struct FASTAExtractionParameters
+{
+  // Use this many OpenMP threads for extracting paths. Value 0 is interpreted
+  // as 1.
+  size_t num_threads = 1;
+  size_t threads() const { return std::max(this->num_threads, size_t(1)); }
+
+  // Cache GBWT records larger than this size to speed up decompression.
+  size_t large_record_bytes = GFAExtractionParameters::LARGE_RECORD_BYTES;
+
+  // Extract only paths with these sample / contig names. An empty set selects
+  // all samples / contigs.
+  std::unordered_set<std::string> samples, contigs;
+
+  // Write the paths in GBWT path id order. Otherwise the order depends on
+  // thread scheduling.
+  bool ordered = true;
+
+  // Break sequence lines after this many bases. Value 0 means no line breaks.
+  constexpr static size_t LINE_LENGTH = 60;
+  size_t line_length = LINE_LENGTH;
+
+  bool show_progress = false;
+};
+
+//------------------------------------------------------------------------------
+
 /*
   Build GBWT from GFA P-lines and/or W-lines with the following assumptions:
 
@@ -176,7 +218,52 @@ gfa_to_gbwt(const std::string& gfa_filename, const GFAParsingParameters& paramet
 */
 void gbwt_to_gfa(const GBWTGraph& graph, std::ostream& out, const GFAExtractionParameters& parameters = GFAExtractionParameters());
 
+/*
+  Writes the sequences of the selected paths into the output stream as FASTA.
+  Path names follow the libhandlegraph conventions. If the GBWT does not contain
+  path names, the name of each path is its GBWT path id, and sample / contig
+  selection is not possible. Throws `std::runtime_error` on failure.
+
+  Each thread assembles the sequence of one path at a time into its own buffer.
+  With ordered output, the paths are extracted in batches of one path per thread,
+  and the batch is written in path id order after all paths have been extracted.
+  With unordered output, each thread flushes its buffer between paths when the
+  buffer is full.
+*/
+void gbwt_to_fasta(const GBWTGraph& graph, std::ostream& out, const FASTAExtractionParameters& parameters = FASTAExtractionParameters());
+
+// Segment ranks per chunk in `write_translation()`.
+constexpr size_t TRANSLATION_CHUNK_SIZE = 64 * 1024;
+
+/*
+  Writes the segment to node translation of the graph into the output stream as a
+  translation table. There is a line `T<tab>segment<tab>node1,node2,...` for each
+  segment with a translation, ordered by node ids. Segments are formatted in
+  parallel in chunks of `TRANSLATION_CHUNK_SIZE` segment ranks, and the chunks are
+  written in order. Writes nothing if the graph does not have a translation.
+*/
+void write_translation(const GBWTGraph& graph, std::ostream& out, const GFAExtractionParameters& parameters = GFAExtractionParameters());
+
+/*
+  Loads a translation table written by `write_translation()` from a memory-mapped
+  file using multiple threads. The number of threads can be set through OMP.
+  Each segment must map to a nonempty range of consecutive node identifiers, and
+  the ranges must not overlap. Throws `std::runtime_error` on failure.
+
+  The first version replaces the segment translation in the sequence source and
+  updates the next unused node id.
+
+  The second version replaces the segment names and the node-to-segment mapping
+  in the graph. The graph must have a GBWT index, and the translation must not
+  refer to node ids beyond the GBWT alphabet. Every node in the graph must be
+  covered by the translation. Segments that start with a node that is not in the
+  graph get empty names, and so do runs of node ids not covered by it.
+*/
+void load_translation(const std::string& filename, SequenceSource& source);
+void load_translation(const std::string& filename, GBWTGraph& graph);
+
 extern const std::string GFA_EXTENSION; // ".gfa"
+extern const std::string FASTA_EXTENSION; // ".fa"
 
 //------------------------------------------------------------------------------
 
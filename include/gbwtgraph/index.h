@@ -1,8 +1,10 @@
 #ifndef GBWTGRAPH_CONSTRUCTION_H
 #define GBWTGRAPH_CONSTRUCTION_H
 
+#include <algorithm>
 #include <cstdlib>
 #include <functional>
+#include <vector>
 
 #include <omp.h>
 
@@ -18,23 +20,86 @@ namespace gbwtgraph
 
 //------------------------------------------------------------------------------
 
+/*
+  Determine the haplotype counts for the hits cached by index_haplotypes(). Each
+  cache entry is a hit together with the starting node of the window and the number
+  of haplotypes in the window. The counts are summed over the windows starting from
+  the same node in the same orientation, and the maximum is taken over the starting
+  nodes. Sorts the cache and returns the distinct hits with their counts.
+*/
+template<class MinimizerType>
+std::vector<std::pair<std::pair<MinimizerType, pos_t>, size_t>>
+count_window_haplotypes(std::vector<std::pair<std::pair<MinimizerType, pos_t>, std::pair<gbwt::node_type, size_t>>>& cache)
+{
+  typedef std::pair<std::pair<MinimizerType, pos_t>, std::pair<gbwt::node_type, size_t>> cache_entry;
+
+  // Minimizers with the same offset but different keys are equivalent in the default
+  // order, so we must compare the keys explicitly to make equal hits adjacent.
+  std::sort(cache.begin(), cache.end(), [](const cache_entry& a, const cache_entry& b) -> bool
+  {
+    if(a.first.first.key != b.first.first.key) { return (a.first.first.key < b.first.first.key); }
+    return (a < b);
+  });
+
+  std::vector<std::pair<std::pair<MinimizerType, pos_t>, size_t>> hits;
+  for(size_t i = 0; i < cache.size(); )
+  {
+    size_t max_count = 0;
+    size_t j = i;
+    while(j < cache.size() && cache[j].first == cache[i].first)
+    {
+      size_t count = 0;
+      size_t k = j;
+      while(k < cache.size() && cache[k].first == cache[j].first && cache[k].second.first == cache[j].second.first)
+      {
+        count += cache[k].second.second; k++;
+      }
+      max_count = std::max(max_count, count);
+      j = k;
+    }
+    hits.emplace_back(cache[i].first, max_count);
+    i = j;
+  }
+
+  return hits;
+}
+
 /*
   Index the haplotypes in the graph. Insert the minimizers into the provided index.
   Function argument get_payload is used to generate the payload for each position
   stored in the index.
+  If haplotype_counts is set, the index also stores a lower bound for the number of
+  haplotypes supporting each hit in the payload. The count is the largest number of
+  haplotypes over the windows starting from the same node in the same orientation
+  where the kmer is a minimizer. Haplotypes that end before a full window are not
+  enumerated and therefore not counted. The payloads generated by get_payload must
+  leave the bits used for the count unused, and the index must be empty or already
+  use haplotype counts.
   The number of threads can be set through OMP.
 */
 template<class KeyType>
 void
 index_haplotypes(const GBWTGraph& graph, MinimizerIndex<KeyType>& index,
-                 const std::function<payload_type(const pos_t&)>& get_payload)
+                 const std::function<payload_type(const pos_t&)>& get_payload,
+                 bool haplotype_counts = false)
 {
   typedef typename MinimizerIndex<KeyType>::minimizer_type minimizer_type;
 
+  if(haplotype_counts && !(index.use_haplotype_counts()))
+  {
+    std::cerr << "index_haplotypes(): Cannot store haplotype counts in a nonempty index without them" << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+
   int threads = omp_get_max_threads();
 
   // Minimizer caching. We only generate the payloads after we have removed duplicate positions.
+  // When storing haplotype counts, we also cache the starting node of the window and
+  // the number of haplotypes in the window.
+  typedef std::pair<gbwt::node_type, size_t> window_type;
   std::vector<std::vector<std::pair<minimizer_type, pos_t>>> cache(threads);
+  std::vector<std::vector<std::pair<std::pair<minimizer_type, pos_t>, window_type>>> count_cache(threads);
+  std::vector<nid_t> current_start(threads, 0);
   constexpr size_t MINIMIZER_CACHE_SIZE = 1024;
   auto flush_cache = [&](int thread_id)
   {
@@ -52,14 +117,52 @@ index_haplotypes(const GBWTGraph& graph, MinimizerIndex<KeyType>& index,
     }
     cache[thread_id].clear();
   };
+  auto flush_count_cache = [&](int thread_id)
+  {
+    std::vector<std::pair<std::pair<minimizer_type, pos_t>, size_t>> hits = count_window_haplotypes(count_cache[thread_id]);
+    std::vector<payload_type> payload;
+    payload.reserve(hits.size());
+    for(size_t i = 0; i < hits.size(); i++)
+    {
+      payload.push_back(get_payload(hits[i].first.second));
+      if(payload.back().haplotypes() != 0)
+      {
+        #pragma omp critical (cerr)
+        {
+          std::cerr << "index_haplotypes(): The payload uses the bits reserved for haplotype counts" << std::endl;
+        }
+        std::exit(EXIT_FAILURE);
+      }
+    }
+    #pragma omp critical (minimizer_index)
+    {
+      for(size_t i = 0; i < hits.size(); i++)
+      {
+        index.insert(hits[i].first.first, hits[i].first.second, payload[i], hits[i].second);
+      }
+    }
+    count_cache[thread_id].clear();
+  };
 
   // Minimizer finding.
-  auto find_minimizers = [&](const std::vector<handle_t>& traversal, const std::string& seq)
+  auto find_minimizers = [&](const std::vector<handle_t>& traversal, const std::string& seq, const gbwt::SearchState& state)
   {
+    int thread_id = omp_get_thread_num();
+    if(haplotype_counts)
+    {
+      // The counts can only be summed over the windows starting from the same node,
+      // so we flush the cache only when the starting node changes.
+      nid_t start = graph.get_id(traversal.front());
+      if(start != current_start[thread_id])
+      {
+        if(count_cache[thread_id].size() >= MINIMIZER_CACHE_SIZE) { flush_count_cache(thread_id); }
+        current_start[thread_id] = start;
+      }
+    }
+
     std::vector<minimizer_type> minimizers = index.minimizers(seq); // Calls syncmers() when appropriate.
     auto iter = traversal.begin();
     size_t node_start = 0;
-    int thread_id = omp_get_thread_num();
     for(minimizer_type& minimizer : minimizers)
     {
       if(minimizer.empty()) { continue; }
@@ -82,9 +185,14 @@ index_haplotypes(const GBWTGraph& graph, MinimizerIndex<KeyType>& index,
         }
         std::exit(EXIT_FAILURE);
       }
-      cache[thread_id].emplace_back(minimizer, pos);
+      if(haplotype_counts)
+      {
+        window_type window(GBWTGraph::handle_to_node(traversal.front()), state.size());
+        count_cache[thread_id].emplace_back(std::make_pair(minimizer, pos), window);
+      }
+      else { cache[thread_id].emplace_back(minimizer, pos); }
     }
-    if(cache[thread_id].size() >= MINIMIZER_CACHE_SIZE) { flush_cache(thread_id); }
+    if(!haplotype_counts && cache[thread_id].size() >= MINIMIZER_CACHE_SIZE) { flush_cache(thread_id); }
   };
 
   /*
@@ -95,9 +203,125 @@ index_haplotypes(const GBWTGraph& graph, MinimizerIndex<KeyType>& index,
     reverse node).
   */
   for_each_haplotype_window(graph, index.window_bp(), find_minimizers, (threads > 1));
-  for(int thread_id = 0; thread_id < threads; thread_id++) { flush_cache(thread_id); }
+  for(int thread_id = 0; thread_id < threads; thread_id++)
+  {
+    if(haplotype_counts) { flush_count_cache(thread_id); }
+    else { flush_cache(thread_id); }
+  }
 }
   
+/*
+  Update the index with new haplotypes. The graph must contain the haplotypes already
+  in the index and the new haplotypes with the given GBWT path identifiers. Only the
+  windows along the new haplotypes are enumerated, and the new minimizer occurrences
+  are inserted into the index with payloads generated by get_payload. If the index
+  stores haplotype counts, the counts of the existing occurrences are increased by
+  the number of times the new haplotypes visit them, and the payloads generated by
+  get_payload must leave the bits used for the count unused.
+  The number of threads can be set through OMP.
+*/
+template<class KeyType>
+void
+add_haplotypes(const GBWTGraph& graph, MinimizerIndex<KeyType>& index,
+               const std::vector<gbwt::size_type>& path_ids,
+               const std::function<payload_type(const pos_t&)>& get_payload)
+{
+  typedef typename MinimizerIndex<KeyType>::minimizer_type minimizer_type;
+  typedef std::pair<minimizer_type, pos_t> cache_entry;
+
+  int threads = omp_get_max_threads();
+  bool haplotype_counts = index.uses_haplotype_counts();
+
+  // Minimizer caching. We only generate the payloads after we have counted the occurrences.
+  std::vector<std::vector<cache_entry>> cache(threads);
+  constexpr size_t MINIMIZER_CACHE_SIZE = 1024;
+  auto flush_cache = [&](int thread_id)
+  {
+    std::vector<cache_entry>& current_cache = cache[thread_id];
+    std::sort(current_cache.begin(), current_cache.end(), [](const cache_entry& a, const cache_entry& b) -> bool
+    {
+      if(a.first.key != b.first.key) { return (a.first.key < b.first.key); }
+      return (a < b);
+    });
+    std::vector<std::pair<cache_entry, size_t>> hits;
+    for(size_t i = 0; i < current_cache.size(); i++)
+    {
+      if(hits.empty() || hits.back().first != current_cache[i]) { hits.emplace_back(current_cache[i], 1); }
+      else { hits.back().second++; }
+    }
+    std::vector<payload_type> payload;
+    payload.reserve(hits.size());
+    for(size_t i = 0; i < hits.size(); i++)
+    {
+      payload.push_back(get_payload(hits[i].first.second));
+      if(haplotype_counts && payload.back().haplotypes() != 0)
+      {
+        #pragma omp critical (cerr)
+        {
+          std::cerr << "add_haplotypes(): The payload uses the bits reserved for haplotype counts" << std::endl;
+        }
+        std::exit(EXIT_FAILURE);
+      }
+    }
+    #pragma omp critical (minimizer_index)
+    {
+      for(size_t i = 0; i < hits.size(); i++)
+      {
+        if(haplotype_counts) { index.add_haplotypes(hits[i].first.first, hits[i].first.second, payload[i], hits[i].second); }
+        else { index.insert(hits[i].first.first, hits[i].first.second, payload[i]); }
+      }
+    }
+    cache[thread_id].clear();
+  };
+
+  // Find the minimizers along each new haplotype. Because the minimizers are canonical,
+  // the forward orientation of the path is enough.
+  #pragma omp parallel for schedule(dynamic, 1)
+  for(size_t i = 0; i < path_ids.size(); i++)
+  {
+    int thread_id = omp_get_thread_num();
+    gbwt::vector_type path = graph.index->extract(gbwt::Path::encode(path_ids[i], false));
+    std::string seq;
+    for(gbwt::node_type node : path)
+    {
+      view_type view = graph.get_sequence_view(GBWTGraph::node_to_handle(node));
+      seq.append(view.first, view.second);
+    }
+
+    std::vector<minimizer_type> minimizers = index.minimizers(seq); // Calls syncmers() when appropriate.
+    auto iter = path.begin();
+    size_t node_start = 0;
+    for(minimizer_type& minimizer : minimizers)
+    {
+      if(minimizer.empty()) { continue; }
+
+      // Find the node covering minimizer starting position.
+      handle_t handle = GBWTGraph::node_to_handle(*iter);
+      size_t node_length = graph.get_length(handle);
+      while(node_start + node_length <= minimizer.offset)
+      {
+        node_start += node_length;
+        ++iter;
+        handle = GBWTGraph::node_to_handle(*iter);
+        node_length = graph.get_length(handle);
+      }
+      pos_t pos { graph.get_id(handle), graph.get_is_reverse(handle), minimizer.offset - node_start };
+      if(minimizer.is_reverse) { pos = reverse_base_pos(pos, node_length); }
+      if(!Position::valid_offset(pos))
+      {
+        #pragma omp critical (cerr)
+        {
+          std::cerr << "add_haplotypes(): Node offset " << offset(pos) << " is too large" << std::endl;
+        }
+        std::exit(EXIT_FAILURE);
+      }
+      cache[thread_id].emplace_back(minimizer, pos);
+      if(cache[thread_id].size() >= MINIMIZER_CACHE_SIZE) { flush_cache(thread_id); }
+    }
+  }
+  for(int thread_id = 0; thread_id < threads; thread_id++) { flush_cache(thread_id); }
+}
+
 //------------------------------------------------------------------------------
 
 } // namespace gbwtgraph
@@ -23,6 +23,28 @@ namespace gbwtgraph
 
 //------------------------------------------------------------------------------
 
+// Maximum length of the decimal representation of a 64-bit integer.
+constexpr size_t MAX_INTEGER_LENGTH = 20;
+
+// Writes the decimal representation of the value into the buffer, which must
+// have room for `MAX_INTEGER_LENGTH` characters. Returns the length.
+inline size_t
+format_integer(size_t value, char* buffer)
+{
+  char digits[MAX_INTEGER_LENGTH];
+  size_t length = 0;
+  do
+  {
+    digits[length] = '0' + value % 10; length++;
+    value /= 10;
+  }
+  while(value > 0);
+  for(size_t i = 0; i < length; i++) { buffer[i] = digits[length - 1 - i]; }
+  return length;
+}
+
+//------------------------------------------------------------------------------
+
 /*
   A buffered TSV writer for single-threaded situtations.
 */
@@ -43,8 +65,8 @@ struct TSVWriter
   void write(const std::string& str) { this->write(view_type(str.data(), str.length())); }
   void write(size_t value)
   {
-    std::string str = std::to_string(value);
-    this->write(str);
+    char buffer[MAX_INTEGER_LENGTH];
+    this->write(view_type(buffer, format_integer(value, buffer)));
   }
 
   void flush();
@@ -74,8 +96,8 @@ struct ManualTSVWriter
   void write(const std::string& str) { this->write(view_type(str.data(), str.length())); }
   void write(size_t value)
   {
-    std::string str = std::to_string(value);
-    this->write(str);
+    char buffer[MAX_INTEGER_LENGTH];
+    this->write(view_type(buffer, format_integer(value, buffer)));
   }
 
   bool full() const { return this->buffer.size() >= BUFFER_FULL; }
@@ -1,9 +1,12 @@
 #ifndef GBWTGRAPH_IO_H
 #define GBWTGRAPH_IO_H
 
+#include <cerrno>
 #include <iostream>
 #include <vector>
 
+#include <unistd.h>
+
 /*
   io.h: Internal I/O functions.
 */
@@ -131,6 +134,21 @@ serialize_hash_table(std::ostream& out, const std::vector<CellType>& hash_table,
   return bytes;
 }
 
+// Write the bytes to the file descriptor at the given offset. Returns true if successful.
+inline bool
+write_at(int fd, const void* data, size_t bytes, size_t offset)
+{
+  const char* ptr = static_cast<const char*>(data);
+  while(bytes > 0)
+  {
+    ssize_t written = ::pwrite(fd, ptr, bytes, offset);
+    if(written < 0 && errno == EINTR) { continue; }
+    if(written <= 0) { return false; }
+    ptr += written; bytes -= written; offset += written;
+  }
+  return true;
+}
+
 } // namespace io
 
 //------------------------------------------------------------------------------
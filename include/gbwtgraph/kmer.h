@@ -0,0 +1,355 @@
+#ifndef GBWTGRAPH_KMER_H
+#define GBWTGRAPH_KMER_H
+
+#include <algorithm>
+#include <cstdint>
+#include <functional>
+#include <iostream>
+#include <stdexcept>
+#include <string>
+#include <unordered_map>
+#include <utility>
+#include <vector>
+
+#include <omp.h>
+
+#include <gbwtgraph/gbwtgraph.h>
+#include <gbwtgraph/io.h>
+#include <gbwtgraph/minimizer.h>
+
+/*
+  kmer.h: Haplotype-consistent kmer counting.
+*/
+
+namespace gbwtgraph
+{
+
+//------------------------------------------------------------------------------
+
+struct KmerHeader
+{
+  std::uint32_t tag, version;
+  std::uint64_t k;
+  std::uint64_t kmers;
+  std::uint64_t total_count;
+  std::uint64_t flags;
+
+  constexpr static std::uint32_t TAG = 0x524D4B47; // "GKMR"
+  constexpr static std::uint32_t VERSION = Version::KMER_VERSION;
+
+  constexpr static std::uint64_t FLAG_MASK       = 0x01FF;
+  constexpr static std::uint64_t FLAG_KEY_MASK   = 0x00FF;
+  constexpr static size_t        FLAG_KEY_OFFSET = 0;
+  constexpr static std::uint64_t FLAG_CANONICAL  = 0x0100;
+
+  KmerHeader();
+  KmerHeader(size_t kmer_length, size_t key_bits, bool canonical);
+
+  // Throws `sdsl::simple_sds::InvalidData` if the header is invalid.
+  void check() const;
+
+  void set(std::uint64_t flag) { this->flags |= flag; }
+  void unset(std::uint64_t flag) { this->flags &= ~flag; }
+  bool get(std::uint64_t flag) const { return (this->flags & flag); }
+
+  size_t key_bits() const { return (this->flags & FLAG_KEY_MASK) >> FLAG_KEY_OFFSET; }
+
+  bool operator==(const KmerHeader& another) const;
+  bool operator!=(const KmerHeader& another) const { return !(this->operator==(another)); }
+};
+
+//------------------------------------------------------------------------------
+
+/*
+  Returns the highest `bits` bits of a kmer key for a kmer of length k, with bits <= 2k.
+  Because the keys are compared as integers, partitioning the keys by the prefix
+  preserves the order.
+*/
+inline size_t
+kmer_prefix(Key64 key, size_t k, size_t bits)
+{
+  if(bits == 0) { return 0; }
+  return key.get_key() >> (2 * k - bits);
+}
+
+inline size_t
+kmer_prefix(Key128 key, size_t k, size_t bits)
+{
+  if(bits == 0) { return 0; }
+  Key128::value_type value = key.get_key();
+  size_t shift = 2 * k - bits;
+  if(shift >= Key128::FIELD_BITS) { return value.first >> (shift - Key128::FIELD_BITS); }
+  size_t result = value.second >> shift;
+  if(shift > 0) { result |= value.first << (Key128::FIELD_BITS - shift); }
+  return result & ((size_t(1) << bits) - 1);
+}
+
+//------------------------------------------------------------------------------
+
+/*
+  A sorted table of kmers and the number of haplotype occurrences of each kmer.
+  The kmers are stored using 2 bits/character in KeyType (Key64 or Key128). If the
+  table is canonical, a kmer and its reverse complement share the smaller key.
+
+  The file format is a header followed by the keys and the counts as two vectors
+  of simple elements.
+
+  Table versions:
+
+    1  The initial version.
+*/
+
+template<class KeyType>
+class KmerTable
+{
+public:
+  typedef KeyType key_type;
+  typedef std::uint64_t count_type;
+
+  KmerHeader              header;
+  std::vector<key_type>   keys;
+  std::vector<count_type> counts;
+
+  KmerTable() : header(0, KeyType::KEY_BITS, true) {}
+
+  KmerTable(size_t k, bool canonical) : header(k, KeyType::KEY_BITS, canonical) {}
+
+  // Kmer length.
+  size_t k() const { return this->header.k; }
+
+  // Do the keys represent canonical kmers?
+  bool canonical() const { return this->header.get(KmerHeader::FLAG_CANONICAL); }
+
+  // Number of distinct kmers.
+  size_t size() const { return this->keys.size(); }
+
+  bool empty() const { return this->keys.empty(); }
+
+  // Sum of the counts over all kmers.
+  size_t total_count() const { return this->header.total_count; }
+
+  // Returns the count for the given key, or 0 if the key is not in the table.
+  // The key must be canonical if the table is canonical.
+  count_type count(key_type key) const
+  {
+    auto iter = std::lower_bound(this->keys.begin(), this->keys.end(), key);
+    if(iter == this->keys.end() || *iter != key) { return 0; }
+    return this->counts[iter - this->keys.begin()];
+  }
+
+  // Returns the count for the given kmer, or 0 if the kmer is not in the table or
+  // contains invalid characters.
+  count_type count(const std::string& kmer) const
+  {
+    if(kmer.length() != this->k()) { return 0; }
+    key_type key;
+    try
+    {
+      key = key_type::encode(kmer);
+      if(this->canonical()) { key = std::min(key, key_type::encode(reverse_complement(kmer))); }
+    }
+    catch(const std::runtime_error&) { return 0; }
+    return this->count(key);
+  }
+
+  // Calls lambda(kmer, count) for each kmer in sorted order.
+  void for_each_kmer(const std::function<void(const std::string&, count_type)>& lambda) const
+  {
+    for(size_t i = 0; i < this->size(); i++) { lambda(this->keys[i].decode(this->k()), this->counts[i]); }
+  }
+
+  // Serialize the table to the ostream. Returns the number of bytes written and
+  // true if the serialization was successful.
+  std::pair<size_t, bool> serialize(std::ostream& out) const
+  {
+    size_t bytes = 0;
+    bool ok = true;
+
+    bytes += io::serialize(out, this->header, ok);
+    bytes += io::serialize_vector(out, this->keys, ok);
+    bytes += io::serialize_vector(out, this->counts, ok);
+
+    if(!ok)
+    {
+      std::cerr << "KmerTable::serialize(): Serialization failed" << std::endl;
+    }
+
+    return std::make_pair(bytes, ok);
+  }
+
+  // Load the table from the istream and return true if successful.
+  bool deserialize(std::istream& in)
+  {
+    bool ok = true;
+
+    ok &= io::load(in, this->header);
+    try { this->header.check(); }
+    catch(const std::runtime_error& e)
+    {
+      std::cerr << e.what() << std::endl;
+      return false;
+    }
+    if(this->header.key_bits() != KeyType::KEY_BITS)
+    {
+      std::cerr << "KmerTable::deserialize(): Expected " << KeyType::KEY_BITS << "-bit keys, got " << this->header.key_bits() << "-bit keys" << std::endl;
+      return false;
+    }
+
+    if(ok) { ok &= io::load_vector(in, this->keys); }
+    if(ok) { ok &= io::load_vector(in, this->counts); }
+    if(ok && (this->keys.size() != this->header.kmers || this->counts.size() != this->header.kmers))
+    {
+      std::cerr << "KmerTable::deserialize(): Kmer count mismatch" << std::endl;
+      ok = false;
+    }
+
+    if(!ok)
+    {
+      std::cerr << "KmerTable::deserialize(): Table loading failed" << std::endl;
+    }
+
+    return ok;
+  }
+
+  // For testing.
+  bool operator==(const KmerTable& another) const
+  {
+    return (this->header == another.header && this->keys == another.keys && this->counts == another.counts);
+  }
+
+  bool operator!=(const KmerTable& another) const { return !(this->operator==(another)); }
+};
+
+//------------------------------------------------------------------------------
+
+/*
+  Count the haplotype-consistent kmers in the graph and return them as a sorted table.
+  The count of a kmer is the number of its occurrences in the haplotypes, as given by
+  the sizes of the GBWT search states at the ends of the windows from
+  for_each_haplotype_window(). If canonical is set, a kmer and its reverse complement
+  are counted together under the smaller key, and each occurrence is counted in one
+  orientation. Otherwise each orientation of each haplotype is counted separately.
+  Kmers containing characters other than ACGT are skipped.
+
+  Each thread collects the counts in its own hash tables, which are partitioned by the
+  highest bits of the key. The partitions are then merged and sorted in parallel.
+  The number of threads can be set through OMP.
+
+  The counts are lower bounds near the ends of haplotypes that share a window with
+  haplotypes that continue further.
+
+  Throws `std::runtime_error` if k is invalid for the key type.
+*/
+template<class KeyType>
+KmerTable<KeyType>
+count_haplotype_kmers(const GBWTGraph& graph, size_t k, bool canonical = true)
+{
+  typedef typename KmerTable<KeyType>::count_type count_type;
+
+  if(k == 0 || k > KeyType::KMER_MAX_LENGTH)
+  {
+    throw std::runtime_error("count_haplotype_kmers(): Kmer length must be between 1 and " + std::to_string(KeyType::KMER_MAX_LENGTH));
+  }
+
+  struct KeyHasher
+  {
+    size_t operator()(KeyType key) const { return key.hash(); }
+  };
+  typedef std::unordered_map<KeyType, count_type, KeyHasher> partition_type;
+
+  constexpr size_t PARTITION_BITS = 8;
+  size_t prefix_bits = std::min(PARTITION_BITS, 2 * k);
+  size_t partitions = size_t(1) << prefix_bits;
+  int threads = omp_get_max_threads();
+  std::vector<std::vector<partition_type>> tables(threads, std::vector<partition_type>(partitions));
+
+  auto add_kmer = [&](int thread_id, KeyType key, count_type count)
+  {
+    tables[thread_id][kmer_prefix(key, k, prefix_bits)][key] += count;
+  };
+
+  for_each_haplotype_window(graph, k, [&](const std::vector<handle_t>& traversal, const std::string& seq, const gbwt::SearchState& state)
+  {
+    int thread_id = omp_get_thread_num();
+    count_type haplotypes = state.size();
+    if(haplotypes == 0) { return; }
+
+    // Only the kmers starting in the first node belong to this window.
+    size_t limit = std::min(graph.get_length(traversal.front()) + k - 1, seq.length());
+    KeyType forward_key, reverse_key;
+    size_t valid_chars = 0;
+    for(size_t i = 0; i < limit; i++)
+    {
+      forward_key.forward(k, seq[i], valid_chars);
+      reverse_key.reverse(k, seq[i]);
+      if(valid_chars < k) { continue; }
+      // With canonical keys, an occurrence is seen in both orientations. We count it in the
+      // orientation where the kmer is canonical, except for palindromes that are canonical
+      // in both orientations. The counts are doubled so that we can halve them later.
+      if(!canonical) { add_kmer(thread_id, forward_key, haplotypes); }
+      else if(forward_key < reverse_key) { add_kmer(thread_id, forward_key, 2 * haplotypes); }
+      else if(forward_key == reverse_key) { add_kmer(thread_id, forward_key, haplotypes); }
+    }
+  }, (threads > 1));
+
+  // Merge and sort the partitions.
+  std::vector<std::vector<std::pair<KeyType, count_type>>> sorted(partitions);
+  #pragma omp parallel for schedule(dynamic, 1)
+  for(size_t partition = 0; partition < partitions; partition++)
+  {
+    partition_type merged;
+    for(int thread_id = 0; thread_id < threads; thread_id++)
+    {
+      partition_type& source = tables[thread_id][partition];
+      if(merged.empty()) { merged.swap(source); }
+      else
+      {
+        for(auto& entry : source) { merged[entry.first] += entry.second; }
+      }
+      partition_type().swap(source);
+    }
+    std::vector<std::pair<KeyType, count_type>>& result = sorted[partition];
+    result.reserve(merged.size());
+    for(auto& entry : merged)
+    {
+      count_type count = entry.second;
+      if(canonical) { count /= 2; }
+      result.emplace_back(entry.first, count);
+    }
+    std::sort(result.begin(), result.end(), [](const std::pair<KeyType, count_type>& a, const std::pair<KeyType, count_type>& b) -> bool
+    {
+      return (a.first < b.first);
+    });
+  }
+  tables.clear();
+
+  // Concatenate the partitions.
+  KmerTable<KeyType> table(k, canonical);
+  std::vector<size_t> offsets(partitions + 1, 0);
+  for(size_t partition = 0; partition < partitions; partition++)
+  {
+    offsets[partition + 1] = offsets[partition] + sorted[partition].size();
+  }
+  table.keys.resize(offsets.back());
+  table.counts.resize(offsets.back());
+  #pragma omp parallel for schedule(dynamic, 1)
+  for(size_t partition = 0; partition < partitions; partition++)
+  {
+    for(size_t i = 0; i < sorted[partition].size(); i++)
+    {
+      table.keys[offsets[partition] + i] = sorted[partition][i].first;
+      table.counts[offsets[partition] + i] = sorted[partition][i].second;
+    }
+    std::vector<std::pair<KeyType, count_type>>().swap(sorted[partition]);
+  }
+  table.header.kmers = table.keys.size();
+  for(count_type count : table.counts) { table.header.total_count += count; }
+
+  return table;
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace gbwtgraph
+
+#endif // GBWTGRAPH_KMER_H
@@ -3,6 +3,7 @@
 
 #include <algorithm>
 #include <cstdint>
+#include <cstring>
 #include <functional>
 #include <iostream>
 #include <limits>
@@ -12,6 +13,16 @@
 
 #include <gbwt/utils.h>
 
+#include <fcntl.h>
+#include <omp.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#if defined(__AVX2__) || defined(__SSE4_2__)
+#include <immintrin.h>
+#endif
+
 #include <gbwtgraph/io.h>
 #include <gbwtgraph/utils.h>
 
@@ -36,10 +47,11 @@ struct MinimizerHeader
   constexpr static std::uint32_t TAG = 0x31513151;
   constexpr static std::uint32_t VERSION = Version::MINIMIZER_VERSION;
 
-  constexpr static std::uint64_t FLAG_MASK       = 0x01FF;
-  constexpr static std::uint64_t FLAG_KEY_MASK   = 0x00FF;
-  constexpr static size_t        FLAG_KEY_OFFSET = 0;
-  constexpr static std::uint64_t FLAG_SYNCMERS   = 0x0100;
+  constexpr static std::uint64_t FLAG_MASK              = 0x03FF;
+  constexpr static std::uint64_t FLAG_KEY_MASK          = 0x00FF;
+  constexpr static size_t        FLAG_KEY_OFFSET        = 0;
+  constexpr static std::uint64_t FLAG_SYNCMERS          = 0x0100;
+  constexpr static std::uint64_t FLAG_HAPLOTYPE_COUNTS  = 0x0200;
 
   MinimizerHeader();
   MinimizerHeader(size_t kmer_length, size_t window_length, size_t initial_capacity, double max_load_factor, size_t key_bits);
@@ -86,6 +98,25 @@ struct payload_type
     return { value, 0 };
   }
 
+  /*
+    When the minimizer index stores haplotype counts, the high HAPLOTYPE_BITS bits
+    of the second field contain the number of haplotypes supporting the hit. Larger
+    counts are truncated to HAPLOTYPE_MASK.
+  */
+  constexpr static size_t        HAPLOTYPE_BITS   = 16;
+  constexpr static size_t        HAPLOTYPE_OFFSET = 64 - HAPLOTYPE_BITS;
+  constexpr static std::uint64_t HAPLOTYPE_MASK   = (static_cast<std::uint64_t>(1) << HAPLOTYPE_BITS) - 1;
+
+  // Returns the haplotype count stored in the payload.
+  size_t haplotypes() const { return (this->second >> HAPLOTYPE_OFFSET) & HAPLOTYPE_MASK; }
+
+  // Stores the haplotype count in the payload.
+  void set_haplotypes(size_t count)
+  {
+    std::uint64_t value = std::min(static_cast<std::uint64_t>(count), HAPLOTYPE_MASK);
+    this->second = (this->second & ~(HAPLOTYPE_MASK << HAPLOTYPE_OFFSET)) | (value << HAPLOTYPE_OFFSET);
+  }
+
   bool operator==(payload_type another) const
   {
     return (this->first == another.first && this->second == another.second);
@@ -142,6 +173,23 @@ struct Position
   static nid_t id(code_type pos) { return (pos >> ID_OFFSET); }
 };
 
+/*
+  Decode the subset of minimizer hits and their payloads supported by at least
+  min_haplotypes haplotypes. This only makes sense if the minimizer index stores
+  haplotype counts in the payloads.
+  If the minimizer is in reverse orientation, use reverse_base_pos() to reverse
+  the reported occurrences.
+*/
+template<class ReportHit>
+void
+hits_with_haplotypes(size_t hit_count, const hit_type* hits, size_t min_haplotypes, const ReportHit& report_hit)
+{
+  for(const hit_type* ptr = hits; ptr < hits + hit_count; ++ptr)
+  {
+    if(ptr->payload.haplotypes() >= min_haplotypes) { report_hit(Position::decode(ptr->pos), ptr->payload); }
+  }
+}
+
 //------------------------------------------------------------------------------
 
 /*
@@ -185,6 +233,9 @@ public:
   // Hash of the key.
   size_t hash() const { return wang_hash_64(this->key & KEY_MASK); }
 
+  // Computes the hashes of n keys using vector instructions if available.
+  static void hash_keys(const Key64* keys, size_t* hashes, size_t n);
+
   // Move the kmer forward, with c as the next character. Update the key, assuming that
   // it encodes the kmer in forward orientation.
   void forward(size_t k, unsigned char c, size_t& valid_chars)
@@ -296,6 +347,9 @@ public:
     return result;
   }
 
+  // Computes the hashes of n keys.
+  static void hash_keys(const Key128* keys, size_t* hashes, size_t n);
+
   // Move the kmer forward, with c as the next character. Update the key, assuming that
   // it encodes the kmer in forward orientation.
   void forward(size_t k, unsigned char c, size_t& valid_chars)
@@ -426,6 +480,12 @@ public:
   // Serialize the hash table in blocks of this many cells.
   constexpr static size_t BLOCK_SIZE = 4 * gbwt::MEGABYTE;
 
+  // Parallel serialization processes the hash table in blocks of this many cells.
+  constexpr static size_t PARALLEL_BLOCK_SIZE = 64 * 1024;
+
+  // Batch minimizer extraction processes approximately this many kmers at once.
+  constexpr static size_t BATCH_KMERS = 64 * 1024;
+
   const static std::string EXTENSION; // ".min"
 
   union value_type
@@ -602,6 +662,132 @@ public:
     return ok;
   }
 
+  /*
+    Serialize the index to the file using multiple threads. The file format is the
+    same as with serialize(). The hash table is divided into blocks of
+    PARALLEL_BLOCK_SIZE cells, and each thread writes the cells and the occurrence
+    lists of a block to precomputed file offsets.
+    The number of threads can be set through OMP.
+    Returns true if the serialization was successful.
+  */
+  bool parallel_serialize(const std::string& filename) const
+  {
+    size_t blocks = (this->capacity() + PARALLEL_BLOCK_SIZE - 1) / PARALLEL_BLOCK_SIZE;
+    size_t table_offset = sizeof(this->header) + sizeof(size_t);
+
+    // Determine the file offsets for the occurrence lists in each block.
+    std::vector<size_t> list_offsets(blocks + 1, 0);
+    #pragma omp parallel for schedule(dynamic, 1)
+    for(size_t block = 0; block < blocks; block++)
+    {
+      size_t start = block * PARALLEL_BLOCK_SIZE, limit = std::min(start + PARALLEL_BLOCK_SIZE, this->capacity());
+      size_t bytes = 0;
+      for(size_t i = start; i < limit; i++)
+      {
+        const cell_type& cell = this->hash_table[i];
+        if(cell.first.is_pointer()) { bytes += sizeof(size_t) + cell.second.pointer->size() * sizeof(hit_type); }
+      }
+      list_offsets[block + 1] = bytes;
+    }
+    list_offsets[0] = table_offset + this->capacity() * sizeof(cell_type);
+    for(size_t block = 0; block < blocks; block++) { list_offsets[block + 1] += list_offsets[block]; }
+
+    int fd = ::open(filename.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if(fd < 0)
+    {
+      std::cerr << "MinimizerIndex::parallel_serialize(): Cannot open file " << filename << std::endl;
+      return false;
+    }
+
+    bool ok = true;
+    size_t capacity = this->capacity();
+    ok &= io::write_at(fd, &(this->header), sizeof(this->header), 0);
+    ok &= io::write_at(fd, &capacity, sizeof(capacity), sizeof(this->header));
+
+    #pragma omp parallel for schedule(dynamic, 1)
+    for(size_t block = 0; block < blocks; block++)
+    {
+      size_t start = block * PARALLEL_BLOCK_SIZE, limit = std::min(start + PARALLEL_BLOCK_SIZE, this->capacity());
+
+      // Replace pointers with empty values to ensure that the file contents are deterministic.
+      std::vector<cell_type> cells(this->hash_table.begin() + start, this->hash_table.begin() + limit);
+      std::vector<char> lists;
+      lists.reserve(list_offsets[block + 1] - list_offsets[block]);
+      for(size_t i = 0; i < cells.size(); i++)
+      {
+        if(cells[i].first.is_pointer())
+        {
+          const std::vector<hit_type>* occs = cells[i].second.pointer;
+          size_t size = occs->size();
+          const char* size_bytes = reinterpret_cast<const char*>(&size);
+          const char* occ_bytes = reinterpret_cast<const char*>(occs->data());
+          lists.insert(lists.end(), size_bytes, size_bytes + sizeof(size));
+          lists.insert(lists.end(), occ_bytes, occ_bytes + size * sizeof(hit_type));
+          cells[i].second.value = empty_hit();
+        }
+      }
+
+      bool block_ok = io::write_at(fd, cells.data(), cells.size() * sizeof(cell_type), table_offset + start * sizeof(cell_type));
+      block_ok &= io::write_at(fd, lists.data(), lists.size(), list_offsets[block]);
+      if(!block_ok)
+      {
+        #pragma omp critical (minimizer_index_io)
+        {
+          ok = false;
+        }
+      }
+    }
+
+    if(::close(fd) != 0) { ok = false; }
+    if(!ok)
+    {
+      std::cerr << "MinimizerIndex::parallel_serialize(): Serialization failed" << std::endl;
+    }
+
+    return ok;
+  }
+
+  /*
+    Load the index from the file using multiple threads and return true if
+    successful. The file is memory-mapped, the hash table is copied in parallel,
+    and the occurrence lists are allocated and copied in parallel.
+    The number of threads can be set through OMP.
+  */
+  bool parallel_deserialize(const std::string& filename)
+  {
+    int fd = ::open(filename.c_str(), O_RDONLY);
+    if(fd < 0)
+    {
+      std::cerr << "MinimizerIndex::parallel_deserialize(): Cannot open file " << filename << std::endl;
+      return false;
+    }
+    struct stat st;
+    if(::fstat(fd, &st) < 0 || st.st_size == 0)
+    {
+      std::cerr << "MinimizerIndex::parallel_deserialize(): Cannot stat file " << filename << std::endl;
+      ::close(fd);
+      return false;
+    }
+    size_t file_size = st.st_size;
+    void* ptr = ::mmap(nullptr, file_size, PROT_READ, MAP_FILE | MAP_SHARED, fd, 0);
+    if(ptr == MAP_FAILED)
+    {
+      std::cerr << "MinimizerIndex::parallel_deserialize(): Cannot memory map file " << filename << std::endl;
+      ::close(fd);
+      return false;
+    }
+
+    bool ok = this->load_mapped(static_cast<const char*>(ptr), file_size);
+    if(!ok)
+    {
+      std::cerr << "MinimizerIndex::parallel_deserialize(): Index loading failed" << std::endl;
+    }
+
+    ::munmap(ptr, file_size);
+    ::close(fd);
+    return ok;
+  }
+
   // For testing.
   bool operator==(const MinimizerIndex& another) const
   {
@@ -662,9 +848,14 @@ public:
 
     // Advance to the next offset (pos) with a valid kmer.
     void advance(offset_type pos, key_type forward_key, key_type reverse_key)
+    {
+      this->advance(pos, forward_key, forward_key.hash(), reverse_key, reverse_key.hash());
+    }
+
+    // Advance to the next offset (pos) with a valid kmer with precomputed hashes.
+    void advance(offset_type pos, key_type forward_key, size_t forward_hash, key_type reverse_key, size_t reverse_hash)
     {
       if(!(this->empty()) && this->front().offset + this->w <= pos) { this->head++; }
-      size_t forward_hash = forward_key.hash(), reverse_hash = reverse_key.hash();
       size_t hash = std::min(forward_hash, reverse_hash);
       while(!(this->empty()) && this->back().hash > hash) { this->tail--; }
       this->tail++;
@@ -751,6 +942,118 @@ public:
   {
     return this->minimizers(str.begin(), str.end());
   }
+
+  /*
+    Returns the minimizers in a batch of reads. The minimizers of read i are in
+    result[offsets[i]] to result[offsets[i + 1] - 1], and they are the same as
+    minimizers(reads[i]) would return.
+
+    The reads are processed in batches of approximately BATCH_KMERS kmers. The
+    rolling keys and their hashes are stored in separate arrays for the entire
+    batch, and the hashes are computed using vector instructions when possible.
+
+    Calls syncmers() for each read if the index uses closed syncmers.
+  */
+  std::vector<minimizer_type> minimizers(const std::vector<std::string>& reads, std::vector<size_t>& offsets) const
+  {
+    std::vector<minimizer_type> result;
+    offsets.clear();
+    offsets.reserve(reads.size() + 1);
+    offsets.push_back(0);
+    if(this->uses_syncmers())
+    {
+      for(const std::string& read : reads)
+      {
+        std::vector<minimizer_type> syncmers = this->syncmers(read.begin(), read.end());
+        result.insert(result.end(), syncmers.begin(), syncmers.end());
+        offsets.push_back(result.size());
+      }
+      return result;
+    }
+
+    // Kmers in the current batch. Kmer j of the read starts at kmer_start[read] + j.
+    std::vector<key_type> forward_keys, reverse_keys;
+    std::vector<size_t> forward_hashes, reverse_hashes;
+    std::vector<bool> valid_kmers;
+    std::vector<size_t> kmer_start;
+
+    size_t window_length = this->window_bp();
+    for(size_t batch_start = 0; batch_start < reads.size(); )
+    {
+      // Determine the batch and the rolling keys.
+      forward_keys.clear(); reverse_keys.clear(); valid_kmers.clear(); kmer_start.clear();
+      size_t batch_end = batch_start;
+      while(batch_end < reads.size() && (batch_end == batch_start || forward_keys.size() < BATCH_KMERS))
+      {
+        const std::string& read = reads[batch_end];
+        kmer_start.push_back(forward_keys.size());
+        key_type forward_key, reverse_key;
+        size_t valid_chars = 0;
+        for(size_t i = 0; i < read.length(); i++)
+        {
+          forward_key.forward(this->k(), read[i], valid_chars);
+          reverse_key.reverse(this->k(), read[i]);
+          if(i + 1 >= this->k())
+          {
+            forward_keys.push_back(forward_key); reverse_keys.push_back(reverse_key);
+            valid_kmers.push_back(valid_chars >= this->k());
+          }
+        }
+        batch_end++;
+      }
+      kmer_start.push_back(forward_keys.size());
+
+      // Compute the hashes.
+      forward_hashes.resize(forward_keys.size()); reverse_hashes.resize(reverse_keys.size());
+      key_type::hash_keys(forward_keys.data(), forward_hashes.data(), forward_keys.size());
+      key_type::hash_keys(reverse_keys.data(), reverse_hashes.data(), reverse_keys.size());
+
+      // Find the minimizers in each read. This follows the logic of minimizers().
+      for(size_t read = batch_start; read < batch_end; read++)
+      {
+        size_t read_start = result.size();
+        size_t first_kmer = kmer_start[read - batch_start], kmers = kmer_start[read - batch_start + 1] - first_kmer;
+        if(reads[read].length() >= window_length)
+        {
+          CircularBuffer buffer(this->w());
+          size_t next_read_offset = 0;  // The first read offset that may contain a new minimizer.
+          for(size_t start_pos = 0; start_pos < kmers; start_pos++)
+          {
+            size_t kmer = first_kmer + start_pos;
+            if(valid_kmers[kmer])
+            {
+              buffer.advance(start_pos, forward_keys[kmer], forward_hashes[kmer], reverse_keys[kmer], reverse_hashes[kmer]);
+            }
+            else { buffer.advance(start_pos); }
+            // We have a full window with a minimizer.
+            if(start_pos + this->k() >= window_length && !buffer.empty())
+            {
+              if(result.size() == read_start || result.back().hash == buffer.front().hash || result.back().offset < buffer.front().offset)
+              {
+                for(size_t i = buffer.begin(); i < buffer.end() && buffer.at(i).hash == buffer.front().hash; i++)
+                {
+                  if(buffer.at(i).offset >= next_read_offset)
+                  {
+                    result.emplace_back(buffer.at(i));
+                    next_read_offset = buffer.at(i).offset + 1;
+                  }
+                }
+              }
+            }
+          }
+          for(size_t i = read_start; i < result.size(); i++)
+          {
+            if(result[i].is_reverse) { result[i].offset += this->k() - 1; }
+          }
+          std::sort(result.begin() + read_start, result.end());
+        }
+        offsets.push_back(result.size());
+      }
+      batch_start = batch_end;
+    }
+
+    return result;
+  }
   
   /*
     Returns all minimizers in the string specified by the iterators, together
@@ -1008,6 +1311,28 @@ public:
     this->insert(minimizer, code, payload);
   }
 
+  /*
+    Inserts the position and the payload into the index with the given haplotype
+    count, which is stored in the payload. If the position has already been inserted
+    with the same key, replaces the stored count with the maximum of the two counts.
+    The index must use haplotype counts; see use_haplotype_counts().
+    Otherwise the behavior is the same as in the other versions of insert().
+  */
+  void insert(const minimizer_type& minimizer, const pos_t& pos, payload_type payload, size_t haplotypes)
+  {
+    this->insert_haplotypes(minimizer, pos, payload, haplotypes, false);
+  }
+
+  /*
+    As above, but if the position has already been inserted with the same key, adds
+    the given count to the stored count. This is intended for adding haplotypes that
+    have not been indexed before.
+  */
+  void add_haplotypes(const minimizer_type& minimizer, const pos_t& pos, payload_type payload, size_t haplotypes)
+  {
+    this->insert_haplotypes(minimizer, pos, payload, haplotypes, true);
+  }
+
   /*
     Returns the sorted set of occurrences of the minimizer with their payloads.
     Use minimizer() or minimizers() to get the minimizer.
@@ -1034,6 +1359,22 @@ public:
     return result;
   }
 
+  /*
+    As above, but only returns the occurrences supported by at least min_haplotypes
+    haplotypes. If the index does not use haplotype counts, returns all occurrences.
+  */
+  std::vector<std::pair<pos_t, payload_type>> find(const minimizer_type& minimizer, size_t min_haplotypes) const
+  {
+    std::vector<std::pair<pos_t, payload_type>> result;
+    if(!(this->uses_haplotype_counts())) { return this->find(minimizer); }
+    std::pair<size_t, const hit_type*> hits = this->count_and_find(minimizer);
+    hits_with_haplotypes(hits.first, hits.second, min_haplotypes, [&](pos_t pos, payload_type payload)
+    {
+      result.emplace_back(pos, payload);
+    });
+    return result;
+  }
+
   /*
     Returns the occurrence count of the minimizer.
     Use minimizer() or minimizers() to get the minimizer.
@@ -1097,6 +1438,21 @@ public:
   // Does the index use closed syncmers instead of minimizers.
   bool uses_syncmers() const { return this->header.get_flag(MinimizerHeader::FLAG_SYNCMERS); }
 
+  // Does the index store haplotype counts in the payloads.
+  bool uses_haplotype_counts() const { return this->header.get_flag(MinimizerHeader::FLAG_HAPLOTYPE_COUNTS); }
+
+  /*
+    Starts storing haplotype counts in the payloads. This is only possible if the
+    index is empty or already uses haplotype counts. Returns true on success.
+  */
+  bool use_haplotype_counts()
+  {
+    if(this->uses_haplotype_counts()) { return true; }
+    if(!(this->empty())) { return false; }
+    this->header.set(MinimizerHeader::FLAG_HAPLOTYPE_COUNTS);
+    return true;
+  }
+
   // Window length in bp. We are guaranteed to have at least one kmer from the window if
   // all characters within it are valid.
   size_t window_bp() const
@@ -1125,6 +1481,14 @@ public:
   // Number of minimizers with a single occurrence.
   size_t unique_keys() const { return this->header.unique; }
 
+  // Advise the kernel to use transparent huge pages for the hash table. This reduces
+  // TLB misses in random lookups. Rehashing allocates a new table, so this should be
+  // called after construction. Returns the number of bytes covered by the advice.
+  size_t advise_huge_pages() const
+  {
+    return gbwtgraph::advise_huge_pages(this->hash_table.data(), this->hash_table.size() * sizeof(cell_type));
+  }
+
 //------------------------------------------------------------------------------
 
 private:
@@ -1141,6 +1505,73 @@ private:
     this->hash_table = source.hash_table;
   }
 
+  // Load the index from a memory-mapped file using multiple threads.
+  bool load_mapped(const char* data, size_t size)
+  {
+    this->clear();
+
+    // Load and check the header.
+    size_t offset = 0;
+    if(size < sizeof(this->header) + sizeof(size_t)) { return false; }
+    std::memcpy(&(this->header), data, sizeof(this->header)); offset += sizeof(this->header);
+    try { this->header.check(); }
+    catch(const std::runtime_error& e)
+    {
+      std::cerr << e.what() << std::endl;
+      return false;
+    }
+    if(this->header.key_bits() != KeyType::KEY_BITS)
+    {
+      std::cerr << "MinimizerIndex::parallel_deserialize(): Expected " << KeyType::KEY_BITS << "-bit keys, got " << this->header.key_bits() << "-bit keys" << std::endl;
+      return false;
+    }
+    this->header.update_version(KeyType::KEY_BITS);
+
+    // Load the hash table.
+    size_t capacity = 0;
+    std::memcpy(&capacity, data + offset, sizeof(capacity)); offset += sizeof(capacity);
+    if(capacity != this->capacity() || capacity * sizeof(cell_type) > size - offset) { return false; }
+    this->hash_table.resize(capacity);
+    size_t blocks = (capacity + PARALLEL_BLOCK_SIZE - 1) / PARALLEL_BLOCK_SIZE;
+    #pragma omp parallel for schedule(dynamic, 1)
+    for(size_t block = 0; block < blocks; block++)
+    {
+      size_t start = block * PARALLEL_BLOCK_SIZE, limit = std::min(start + PARALLEL_BLOCK_SIZE, capacity);
+      std::memcpy(static_cast<void*>(this->hash_table.data() + start), data + offset + start * sizeof(cell_type), (limit - start) * sizeof(cell_type));
+    }
+    offset += capacity * sizeof(cell_type);
+
+    // Determine the file offsets of the occurrence lists. Until the lists have been
+    // loaded, the pointers are null.
+    std::vector<std::pair<size_t, size_t>> lists; // (cell, file offset)
+    for(size_t i = 0; i < capacity; i++)
+    {
+      cell_type& cell = this->hash_table[i];
+      if(!(cell.first.is_pointer())) { continue; }
+      cell.second.pointer = nullptr;
+      size_t list_size = 0;
+      if(sizeof(list_size) > size - offset) { return false; }
+      std::memcpy(&list_size, data + offset, sizeof(list_size));
+      lists.emplace_back(i, offset);
+      offset += sizeof(list_size);
+      if(list_size > (size - offset) / sizeof(hit_type)) { return false; }
+      offset += list_size * sizeof(hit_type);
+    }
+
+    // Load the occurrence lists.
+    #pragma omp parallel for schedule(dynamic, 1024)
+    for(size_t i = 0; i < lists.size(); i++)
+    {
+      size_t list_size = 0;
+      std::memcpy(&list_size, data + lists[i].second, sizeof(list_size));
+      std::vector<hit_type>* occs = new std::vector<hit_type>(list_size);
+      std::memcpy(static_cast<void*>(occs->data()), data + lists[i].second + sizeof(list_size), list_size * sizeof(hit_type));
+      this->hash_table[lists[i].first].second.pointer = occs;
+    }
+
+    return true;
+  }
+
   // Delete all pointers in the hash table.
   void clear()
   {
@@ -1186,6 +1617,31 @@ private:
     if(this->size() > this->max_keys()) { this->rehash(); }
   }
 
+  // Insert the position with a haplotype count. If the position is already present,
+  // either add the count to the stored count or use the maximum of the counts.
+  void insert_haplotypes(const minimizer_type& minimizer, const pos_t& pos, payload_type payload, size_t haplotypes, bool add)
+  {
+    if(minimizer.empty() || is_empty(pos)) { return; }
+    hit_type hit { Position::encode(pos), payload };
+    hit.payload.set_haplotypes(haplotypes);
+
+    size_t offset = this->find_offset(minimizer.key, minimizer.hash);
+    if(this->hash_table[offset].first == key_type::no_key())
+    {
+      this->insert(minimizer.key, hit, offset);
+    }
+    else if(this->hash_table[offset].first == minimizer.key)
+    {
+      hit_type* existing = this->find_hit(offset, hit);
+      if(existing == nullptr) { this->append(hit, offset); }
+      else if(add) { existing->payload.set_haplotypes(existing->payload.haplotypes() + haplotypes); }
+      else if(existing->payload.haplotypes() < hit.payload.haplotypes())
+      {
+        existing->payload.set_haplotypes(hit.payload.haplotypes());
+      }
+    }
+  }
+
   // Add pos to the list of occurrences of key at hash_table[offset].
   void append(hit_type hit, size_t offset)
   {
@@ -1216,6 +1672,22 @@ private:
     this->header.values++;
   }
 
+  // Returns a pointer to the hit in the list of occurrences at hash_table[offset] or nullptr.
+  hit_type* find_hit(size_t offset, hit_type hit)
+  {
+    cell_type& cell = this->hash_table[offset];
+    if(cell.first.is_pointer())
+    {
+      std::vector<hit_type>* occs = cell.second.pointer;
+      auto iter = std::lower_bound(occs->begin(), occs->end(), hit);
+      return (iter != occs->end() && *iter == hit ? &*iter : nullptr);
+    }
+    else
+    {
+      return (cell.second.value == hit ? &(cell.second.value) : nullptr);
+    }
+  }
+
   // Does the list of occurrences at hash_table[offset] contain the hit?
   bool contains(size_t offset, hit_type hit) const
   {
@@ -1262,27 +1734,234 @@ operator<<(std::ostream& out, const typename MinimizerIndex<KeyType>::minimizer_
 
 //------------------------------------------------------------------------------
 
+/*
+  Hits in a subgraph.
+
+  The templated versions of hits_in_subgraph() call report_hit(pos_t, payload_type)
+  directly, which lets the compiler inline the callback. The versions taking a
+  std::function are thin wrappers over them.
+
+  If the minimizer is in reverse orientation, use reverse_base_pos() to reverse
+  the reported occurrences.
+*/
+
+/*
+  A bitmap over node ids min_id to max_id (inclusive) in a subgraph induced by node
+  identifiers. Membership queries are cheaper than hash lookups, and the bitmap takes
+  less space than a hash table when the node ids in the subgraph are dense.
+*/
+struct SubgraphBitmap
+{
+  nid_t            min_id;
+  sdsl::bit_vector bits;
+
+  // A subgraph is dense if the bitmap uses at most this many bits per node.
+  constexpr static size_t MAX_BITS_PER_NODE = 64;
+
+  SubgraphBitmap() : min_id(0) {}
+
+  // Build a bitmap for any container of node ids.
+  template<class Container>
+  explicit SubgraphBitmap(const Container& subgraph) :
+    min_id(0)
+  {
+    if(subgraph.empty()) { return; }
+    auto range = std::minmax_element(subgraph.begin(), subgraph.end());
+    this->min_id = *(range.first);
+    this->bits = sdsl::bit_vector(*(range.second) - this->min_id + 1, 0);
+    for(nid_t id : subgraph) { this->bits[id - this->min_id] = 1; }
+  }
+
+  size_t universe() const { return this->bits.size(); }
+  bool empty() const { return (this->universe() == 0); }
+
+  bool contains(nid_t id) const
+  {
+    return (id >= this->min_id && static_cast<size_t>(id - this->min_id) < this->universe() && this->bits[id - this->min_id]);
+  }
+
+  // Is a bitmap a good representation for a subgraph of the given size over node ids min_id to max_id?
+  static bool is_dense(size_t nodes, nid_t min_id, nid_t max_id)
+  {
+    if(nodes == 0 || max_id < min_id) { return false; }
+    return (static_cast<size_t>(max_id - min_id) + 1 <= nodes * MAX_BITS_PER_NODE);
+  }
+};
+
+/*
+  When the larger list is at most this many times longer than the shorter one,
+  hits_in_subgraph() with a sorted vector of node ids uses a linear merge instead
+  of exponential search.
+*/
+constexpr size_t HITS_IN_SUBGRAPH_MERGE_RATIO = 4;
+
+/*
+  Exponential search that returns the first offset with get_value(offset) >= target.
+  We assume that start < limit and get_value(start) < target.
+  Returns limit if get_value(offset) < target for all offset < limit.
+*/
+template<class Getter>
+size_t
+exponential_search(size_t start, size_t limit, nid_t target, const Getter& get_value)
+{
+  // Exponential search: low is too early.
+  size_t step = 1;
+  size_t low = start, candidate = start + step;
+  while(candidate < limit && get_value(candidate) < target)
+  {
+    step *= 2;
+    low = candidate; candidate += step;
+  }
+
+  // Binary search: low + 1 is the first candidate while candidate is the last.
+  low++;
+  size_t count = std::min(limit, candidate + 1) - low;
+  while(count > 0)
+  {
+    step = count / 2;
+    candidate = low + step;
+    if(get_value(candidate) < target) { low = candidate + 1; count -= step + 1; }
+    else { count = step; }
+  }
+  return low;
+}
+
+/*
+  Linear search over a sorted array that returns the first offset with
+  values[offset] >= target, or limit if there is no such offset. Compares blocks
+  of values with a single vector instruction when AVX2 or SSE4.2 is available.
+*/
+inline size_t
+linear_search(const nid_t* values, size_t start, size_t limit, nid_t target)
+{
+  size_t offset = start;
+#if defined(__AVX2__)
+  __m256i targets = _mm256_set1_epi64x(target);
+  while(offset + 4 <= limit)
+  {
+    __m256i block = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(values + offset));
+    int mask = _mm256_movemask_pd(_mm256_castsi256_pd(_mm256_cmpgt_epi64(targets, block)));
+    if(mask != 0x0F) { return offset + __builtin_popcount(mask); }
+    offset += 4;
+  }
+#elif defined(__SSE4_2__)
+  __m128i targets = _mm_set1_epi64x(target);
+  while(offset + 2 <= limit)
+  {
+    __m128i block = _mm_loadu_si128(reinterpret_cast<const __m128i*>(values + offset));
+    int mask = _mm_movemask_pd(_mm_castsi128_pd(_mm_cmpgt_epi64(targets, block)));
+    if(mask != 0x03) { return offset + __builtin_popcount(mask); }
+    offset += 2;
+  }
+#endif
+  while(offset < limit && values[offset] < target) { offset++; }
+  return offset;
+}
+
 /*
   Decode the subset of minimizer hits and their payloads in the given subgraph induced
   by node identifiers.
   This version should only be used when the number of hits is small.
-  If the minimizer is in reverse orientation, use reverse_base_pos() to reverse
-  the reported occurrences.
 */
-void hits_in_subgraph(size_t hit_count, const hit_type* hits, const std::unordered_set<nid_t>& subgraph,
-                      const std::function<void(pos_t, payload_type)>& report_hit);
+template<class ReportHit>
+void
+hits_in_subgraph(size_t hit_count, const hit_type* hits, const std::unordered_set<nid_t>& subgraph,
+                 const ReportHit& report_hit)
+{
+  for(const hit_type* ptr = hits; ptr < hits + hit_count; ++ptr)
+  {
+    auto iter = subgraph.find(Position::id(ptr->pos));
+    if(iter != subgraph.end()) { report_hit(Position::decode(ptr->pos), ptr->payload); }
+  }
+}
 
 /*
   Decode the subset of minimizer hits and their payloads in the given subgraph induced
   by node identifiers. The set of node ids must be in sorted order.
-  This version uses exponential search on the larger list, so it should be efficient
-  regardless of the size of the subgraph and the number of hits.
-  If the minimizer is in reverse orientation, use reverse_base_pos() to reverse
-  the reported occurrences.
+  If the lists are of similar size, this version merges them using vectorized linear
+  search over the node ids. Otherwise it uses exponential search on the list that is
+  behind. It should be efficient regardless of the size of the subgraph and the
+  number of hits.
 */
+template<class ReportHit>
+void
+hits_in_subgraph(size_t hit_count, const hit_type* hits, const std::vector<nid_t>& subgraph,
+                 const ReportHit& report_hit)
+{
+  size_t hit_offset = 0, subgraph_offset = 0;
+  size_t shorter = std::min(hit_count, subgraph.size()), longer = std::max(hit_count, subgraph.size());
+  if(longer <= HITS_IN_SUBGRAPH_MERGE_RATIO * shorter)
+  {
+    while(hit_offset < hit_count && subgraph_offset < subgraph.size())
+    {
+      nid_t node = Position::id(hits[hit_offset].pos);
+      if(subgraph[subgraph_offset] < node)
+      {
+        subgraph_offset = linear_search(subgraph.data(), subgraph_offset, subgraph.size(), node);
+      }
+      else
+      {
+        if(subgraph[subgraph_offset] == node) { report_hit(Position::decode(hits[hit_offset].pos), hits[hit_offset].payload); }
+        ++hit_offset;
+      }
+    }
+    return;
+  }
+
+  while(hit_offset < hit_count && subgraph_offset < subgraph.size())
+  {
+    nid_t node = Position::id(hits[hit_offset].pos);
+    if(node < subgraph[subgraph_offset])
+    {
+      hit_offset = exponential_search(hit_offset, hit_count, subgraph[subgraph_offset], [&](size_t offset) -> nid_t
+      {
+        return Position::id(hits[offset].pos);
+      });
+    }
+    else if(node > subgraph[subgraph_offset])
+    {
+      subgraph_offset = exponential_search(subgraph_offset, subgraph.size(), node, [&](size_t offset) -> nid_t
+      {
+        return subgraph[offset];
+      });
+    }
+    else
+    {
+      report_hit(Position::decode(hits[hit_offset].pos), hits[hit_offset].payload);
+      ++hit_offset;
+    }
+  }
+}
+
+/*
+  Decode the subset of minimizer hits and their payloads in the given subgraph
+  represented as a bitmap. This version does a constant-time membership query for
+  each hit, and it is a good choice when the subgraph is dense in node id space.
+*/
+template<class ReportHit>
+void
+hits_in_subgraph(size_t hit_count, const hit_type* hits, const SubgraphBitmap& subgraph,
+                 const ReportHit& report_hit)
+{
+  for(const hit_type* ptr = hits; ptr < hits + hit_count; ++ptr)
+  {
+    if(subgraph.contains(Position::id(ptr->pos))) { report_hit(Position::decode(ptr->pos), ptr->payload); }
+  }
+}
+
+/*
+  Versions of hits_in_subgraph() that report the hits through a std::function.
+*/
+
+void hits_in_subgraph(size_t hit_count, const hit_type* hits, const std::unordered_set<nid_t>& subgraph,
+                      const std::function<void(pos_t, payload_type)>& report_hit);
+
 void hits_in_subgraph(size_t hit_count, const hit_type* hits, const std::vector<nid_t>& subgraph,
                       const std::function<void(pos_t, payload_type)>& report_hit);
 
+void hits_in_subgraph(size_t hit_count, const hit_type* hits, const SubgraphBitmap& subgraph,
+                      const std::function<void(pos_t, payload_type)>& report_hit);
+
 //------------------------------------------------------------------------------
 
 // Choose the default index type.
@@ -1297,6 +1976,8 @@ template<class KeyType> constexpr size_t MinimizerIndex<KeyType>::INITIAL_CAPACI
 template<class KeyType> constexpr double MinimizerIndex<KeyType>::MAX_LOAD_FACTOR;
 template<class KeyType> constexpr code_type MinimizerIndex<KeyType>::NO_VALUE;
 template<class KeyType> constexpr payload_type MinimizerIndex<KeyType>::DEFAULT_PAYLOAD;
+template<class KeyType> constexpr size_t MinimizerIndex<KeyType>::PARALLEL_BLOCK_SIZE;
+template<class KeyType> constexpr size_t MinimizerIndex<KeyType>::BATCH_KMERS;
 
 // Other template class variables.
 
@@ -0,0 +1,194 @@
+#ifndef GBWTGRAPH_SEARCH_H
+#define GBWTGRAPH_SEARCH_H
+
+#include <string>
+#include <utility>
+#include <vector>
+
+#include <omp.h>
+
+#include <gbwtgraph/gbwtgraph.h>
+#include <gbwtgraph/minimizer.h>
+
+/*
+  search.h: Exact haplotype-consistent sequence search.
+*/
+
+namespace gbwtgraph
+{
+
+//------------------------------------------------------------------------------
+
+/*
+  An exact occurrence of a query sequence in the haplotypes. The occurrence starts
+  at the given offset in the first node of the path and continues over the entire
+  path. The bidirectional search state contains the GBWT ranges for the haplotypes
+  containing the path in both orientations.
+*/
+struct SequenceMatch
+{
+  std::vector<handle_t>    path;
+  size_t                   offset;
+  gbwt::BidirectionalState state;
+
+  // Number of haplotype occurrences of the match.
+  size_t haplotypes() const { return this->state.size(); }
+
+  // Starting position of the match.
+  pos_t start(const GBWTGraph& graph) const
+  {
+    return make_pos_t(graph.get_id(this->path.front()), graph.get_is_reverse(this->path.front()), this->offset);
+  }
+
+  // Matches are ordered by (path, offset) using the GBWT node identifiers.
+  bool operator<(const SequenceMatch& another) const;
+  bool operator==(const SequenceMatch& another) const;
+  bool operator!=(const SequenceMatch& another) const { return !(this->operator==(another)); }
+};
+
+//------------------------------------------------------------------------------
+
+/*
+  Extend an anchor, where query[query_offset] aligns with graph position graph_pos,
+  into exact haplotype-consistent occurrences of the entire query. The extension
+  first proceeds to the right with the GBWT and then to the left with the
+  bidirectional search states, comparing the query to the node sequences.
+  Appends the matches to the output. Invalid anchors produce no matches.
+*/
+void extend_anchor(const GBWTGraph& graph, const gbwt::CachedGBWT& cache,
+                   const std::string& query, size_t query_offset, pos_t graph_pos,
+                   std::vector<SequenceMatch>& output);
+
+/*
+  Sort the matches and remove duplicates found from different anchors.
+*/
+void sort_matches(std::vector<SequenceMatch>& matches);
+
+/*
+  Find all haplotype-consistent occurrences of the query by using every graph
+  position matching the first query base as an anchor. This is slow for large
+  graphs but does not need an index. Returns the matches in sorted order.
+*/
+std::vector<SequenceMatch> find_haplotype_matches(const GBWTGraph& graph, const gbwt::CachedGBWT& cache, const std::string& query);
+
+/*
+  Batch version of the index-free search using multiple threads. Returns the matches
+  for each query in the same order as the queries.
+  The number of threads can be set through OMP.
+*/
+std::vector<std::vector<SequenceMatch>> find_haplotype_matches(const GBWTGraph& graph, const std::vector<std::string>& queries);
+
+//------------------------------------------------------------------------------
+
+/*
+  Find all haplotype-consistent occurrences of the query using the minimizer index
+  for seeding. The index must have been built from the same graph without a hit cap.
+  Returns the matches in sorted order.
+
+  If the query is at least as long as a minimizer window, every occurrence of the
+  query contains each of its minimizers (or syncmers) at the corresponding position,
+  and the index stores those occurrences. Hence anchoring with the minimizer with the
+  fewest hits finds all occurrences. Shorter queries, or queries without minimizers,
+  fall back to the index-free search.
+*/
+template<class KeyType>
+std::vector<SequenceMatch>
+find_haplotype_matches(const GBWTGraph& graph, const gbwt::CachedGBWT& cache,
+                       const MinimizerIndex<KeyType>& index, const std::string& query)
+{
+  typedef typename MinimizerIndex<KeyType>::minimizer_type minimizer_type;
+
+  std::vector<SequenceMatch> result;
+  if(query.empty()) { return result; }
+  if(query.length() < index.window_bp())
+  {
+    return find_haplotype_matches(graph, cache, query);
+  }
+
+  // Find the minimizer with the fewest hits.
+  std::vector<minimizer_type> minimizers = index.minimizers(query);
+  const minimizer_type* seed = nullptr;
+  size_t seed_hits = 0;
+  for(const minimizer_type& minimizer : minimizers)
+  {
+    if(minimizer.empty()) { continue; }
+    size_t hits = index.count(minimizer);
+    if(seed == nullptr || hits < seed_hits) { seed = &minimizer; seed_hits = hits; }
+    if(seed_hits == 0) { return result; } // No occurrences.
+  }
+  if(seed == nullptr)
+  {
+    return find_haplotype_matches(graph, cache, query);
+  }
+
+  for(const auto& hit : index.find(*seed))
+  {
+    pos_t pos = hit.first;
+    if(!(graph.has_node(id(pos)))) { continue; }
+    if(seed->is_reverse) { pos = reverse_base_pos(pos, graph.get_length(graph.get_handle(id(pos), false))); }
+    extend_anchor(graph, cache, query, seed->offset, pos, result);
+  }
+  sort_matches(result);
+
+  return result;
+}
+
+/*
+  As above, but creates a GBWT cache for the query.
+*/
+template<class KeyType>
+std::vector<SequenceMatch>
+find_haplotype_matches(const GBWTGraph& graph, const MinimizerIndex<KeyType>& index, const std::string& query)
+{
+  gbwt::CachedGBWT cache = graph.get_cache();
+  return find_haplotype_matches(graph, cache, index, query);
+}
+
+/*
+  Batch search for a set of queries using multiple threads. Returns the matches
+  for each query in the same order as the queries.
+  The number of threads can be set through OMP.
+*/
+template<class KeyType>
+std::vector<std::vector<SequenceMatch>>
+find_haplotype_matches(const GBWTGraph& graph, const MinimizerIndex<KeyType>& index, const std::vector<std::string>& queries)
+{
+  std::vector<std::vector<SequenceMatch>> result(queries.size());
+  #pragma omp parallel
+  {
+    gbwt::CachedGBWT cache = graph.get_cache();
+    #pragma omp for schedule(dynamic, 1)
+    for(size_t i = 0; i < queries.size(); i++)
+    {
+      result[i] = find_haplotype_matches(graph, cache, index, queries[i]);
+    }
+  }
+  return result;
+}
+
+//------------------------------------------------------------------------------
+
+/*
+  Batched haplotype queries for many paths, such as the allele paths in genotyping.
+  The paths are organized into a trie in lexicographic order, and the search state
+  is extended once for each trie edge using a GBWT cache. Subtries starting from
+  different nodes are processed in parallel.
+  The number of threads can be set through OMP.
+*/
+
+// Returns the search state for each path. The states are the same as from
+// `GBWTGraph::find()`.
+std::vector<gbwt::SearchState> find_paths(const GBWTGraph& graph, const std::vector<std::vector<handle_t>>& paths);
+
+// Returns the number of haplotype occurrences of each path.
+std::vector<size_t> count_haplotypes(const GBWTGraph& graph, const std::vector<std::vector<handle_t>>& paths);
+
+// Returns the GBWT sequence identifiers of the haplotype occurrences of each path in
+// sorted order. Requires the document array samples in the GBWT index.
+std::vector<std::vector<gbwt::size_type>> locate_haplotypes(const GBWTGraph& graph, const std::vector<std::vector<handle_t>>& paths);
+
+//------------------------------------------------------------------------------
+
+} // namespace gbwtgraph
+
+#endif // GBWTGRAPH_SEARCH_H
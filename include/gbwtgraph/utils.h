@@ -116,6 +116,7 @@ struct Version
   constexpr static size_t GBZ_VERSION       = 1;
   constexpr static size_t GRAPH_VERSION     = 3;
   constexpr static size_t MINIMIZER_VERSION = 8;
+  constexpr static size_t KMER_VERSION      = 1;
 
   const static std::string SOURCE_KEY; // source
   const static std::string SOURCE_VALUE; // jltsiren/gbwtgraph
@@ -298,6 +299,12 @@ wang_hash_64(size_t key)
   return key;
 }
 
+/*
+  Computes wang_hash_64() for n keys and stores the results in hashes. The input
+  and output arrays may be the same. Uses AVX2 instructions if available.
+*/
+void wang_hash_64(const size_t* keys, size_t* hashes, size_t n);
+
 // Essentially boost::hash_combine.
 inline size_t
 hash(nid_t id, bool is_rev, size_t offset)
@@ -318,9 +325,35 @@ hash(const pos_t& pos)
 
 // Utility functions.
 
+/*
+  Reverse complement functions. They support the IUPAC codes in both upper and lower
+  case, as well as '$', '#', and '-'. Other characters become 'N'. The functions use
+  SSSE3 or AVX2 instructions if available.
+*/
+
 std::string reverse_complement(const std::string& seq);
 void reverse_complement_in_place(std::string& seq);
 
+// Writes the reverse complement of seq[0, length) to buffer[0, length).
+// The input and the buffer must not overlap.
+void reverse_complement(const char* seq, size_t length, char* buffer);
+
+// Replaces the contents of the output with the reverse complement of the view.
+void reverse_complement(view_type seq, std::string& output);
+
+//------------------------------------------------------------------------------
+
+// Transparent huge page size on x86-64 and most ARM64 configurations.
+constexpr size_t HUGE_PAGE_SIZE = 2 * 1024 * 1024;
+
+/*
+  Advise the kernel to back the memory region with transparent huge pages. Only the
+  part of the region consisting of whole huge pages is affected, so this is only
+  useful for large arrays. Returns the number of bytes covered by the advice, or 0
+  if the region is too small or huge pages are not available.
+*/
+size_t advise_huge_pages(const void* data, size_t bytes);
+
 //------------------------------------------------------------------------------
 
 /*
@@ -67,6 +67,35 @@ CachedGBWTGraph::CachedGBWTGraph(const GBWTGraph& graph) :
 {
 }
 
+size_t
+CachedGBWTGraph::prewarm(const std::vector<nid_t>& nodes)
+{
+  // Decompressing the records in node order improves memory locality.
+  std::vector<nid_t> sorted(nodes);
+  std::sort(sorted.begin(), sorted.end());
+  sorted.erase(std::unique(sorted.begin(), sorted.end()), sorted.end());
+
+  size_t result = 0;
+  for(nid_t id : sorted)
+  {
+    if(!(this->has_node(id))) { continue; }
+    for(bool is_reverse : { false, true })
+    {
+      this->cache.findRecord(gbwt::Node::encode(id, is_reverse));
+      result++;
+    }
+  }
+
+  return result;
+}
+
+size_t
+CachedGBWTGraph::prewarm(const std::unordered_set<nid_t>& nodes)
+{
+  std::vector<nid_t> as_vector(nodes.begin(), nodes.end());
+  return this->prewarm(as_vector);
+}
+
 //------------------------------------------------------------------------------
 
 bool
@@ -104,21 +133,22 @@ size_t
 CachedGBWTGraph::get_length(const handle_t& handle) const
 {
   size_t offset = this->graph->node_offset(handle);
-  return this->graph->sequences.length(offset);
+  return this->graph->stored_length(offset);
 }
 
 std::string
 CachedGBWTGraph::get_sequence(const handle_t& handle) const
 {
   size_t offset = this->graph->node_offset(handle);
-  return this->graph->sequences.str(offset);
+  view_type view = this->graph->stored_view(offset);
+  return std::string(view.first, view.second);
 }
 
 char
 CachedGBWTGraph::get_base(const handle_t& handle, size_t index) const
 {
   size_t offset = this->graph->node_offset(handle);
-  view_type view = this->graph->sequences.view(offset);
+  view_type view = this->graph->stored_view(offset);
   return *(view.first + index);
 }
 
@@ -126,7 +156,7 @@ std::string
 CachedGBWTGraph::get_subsequence(const handle_t& handle, size_t index, size_t size) const
 {
   size_t offset = this->graph->node_offset(handle);
-  view_type view = this->graph->sequences.view(offset);
+  view_type view = this->graph->stored_view(offset);
   index = std::min(index, view.second);
   size = std::min(size, view.second - index);
   return std::string(view.first + index, view.first + index + size);
@@ -195,6 +225,207 @@ CachedGBWTGraph::has_edge(const handle_t& left, const handle_t& right) const
   return false;
 }
 
+size_t
+CachedGBWTGraph::get_edge_count() const
+{
+  return this->graph->statistics.edges;
+}
+
+size_t
+CachedGBWTGraph::get_total_length() const
+{
+  return this->graph->statistics.total_length;
+}
+
+//------------------------------------------------------------------------------
+
+namespace
+{
+
+// Steps correspond to GBWT edges (node, offset).
+
+gbwt::edge_type
+step_to_edge(const step_handle_t& step)
+{
+  return gbwt::edge_type(handlegraph::as_integers(step)[0], handlegraph::as_integers(step)[1]);
+}
+
+step_handle_t
+edge_to_step(gbwt::edge_type edge)
+{
+  step_handle_t step;
+  handlegraph::as_integers(step)[0] = edge.first;
+  handlegraph::as_integers(step)[1] = edge.second;
+  return step;
+}
+
+} // anonymous namespace
+
+size_t
+CachedGBWTGraph::get_path_count() const
+{
+  return this->graph->get_path_count();
+}
+
+bool
+CachedGBWTGraph::has_path(const std::string& path_name) const
+{
+  return this->graph->has_path(path_name);
+}
+
+path_handle_t
+CachedGBWTGraph::get_path_handle(const std::string& path_name) const
+{
+  return this->graph->get_path_handle(path_name);
+}
+
+std::string
+CachedGBWTGraph::get_path_name(const path_handle_t& path_handle) const
+{
+  return this->graph->get_path_name(path_handle);
+}
+
+bool
+CachedGBWTGraph::get_is_circular(const path_handle_t& path_handle) const
+{
+  return this->graph->get_is_circular(path_handle);
+}
+
+size_t
+CachedGBWTGraph::get_step_count(const path_handle_t& path_handle) const
+{
+  // The lengths of named paths are cached, but haplotypes must be traced.
+  if(this->get_sense(path_handle) != PathSense::HAPLOTYPE) { return this->graph->get_step_count(path_handle); }
+  size_t count = 0;
+  step_handle_t end = this->path_end(path_handle);
+  for(step_handle_t here = this->path_begin(path_handle); here != end; here = this->get_next_step(here)) { count++; }
+  return count;
+}
+
+size_t
+CachedGBWTGraph::get_step_count(const handle_t& handle) const
+{
+  size_t count = 0;
+  this->for_each_step_on_handle_impl(handle, [&](const step_handle_t&) -> bool
+  {
+    count++;
+    return true;
+  });
+  return count;
+}
+
+handle_t
+CachedGBWTGraph::get_handle_of_step(const step_handle_t& step_handle) const
+{
+  return node_to_handle(step_to_edge(step_handle).first);
+}
+
+path_handle_t
+CachedGBWTGraph::get_path_handle_of_step(const step_handle_t& step_handle) const
+{
+  return this->graph->get_path_handle_of_step(step_handle);
+}
+
+step_handle_t
+CachedGBWTGraph::path_begin(const path_handle_t& path_handle) const
+{
+  return this->graph->path_begin(path_handle);
+}
+
+step_handle_t
+CachedGBWTGraph::path_end(const path_handle_t& path_handle) const
+{
+  return this->graph->path_end(path_handle);
+}
+
+step_handle_t
+CachedGBWTGraph::path_back(const path_handle_t& path_handle) const
+{
+  return this->graph->path_back(path_handle);
+}
+
+step_handle_t
+CachedGBWTGraph::path_front_end(const path_handle_t& path_handle) const
+{
+  return this->graph->path_front_end(path_handle);
+}
+
+bool
+CachedGBWTGraph::has_next_step(const step_handle_t& step_handle) const
+{
+  return (step_to_edge(this->get_next_step(step_handle)) != gbwt::invalid_edge());
+}
+
+bool
+CachedGBWTGraph::has_previous_step(const step_handle_t& step_handle) const
+{
+  return (step_to_edge(this->get_previous_step(step_handle)) != gbwt::invalid_edge());
+}
+
+step_handle_t
+CachedGBWTGraph::get_next_step(const step_handle_t& step_handle) const
+{
+  gbwt::edge_type here = step_to_edge(step_handle);
+  here = this->cache.LF(here.first, here.second);
+  if(here.first == gbwt::ENDMARKER) { here = gbwt::invalid_edge(); }
+  return edge_to_step(here);
+}
+
+step_handle_t
+CachedGBWTGraph::get_previous_step(const step_handle_t& step_handle) const
+{
+  gbwt::edge_type here = step_to_edge(step_handle);
+  here = this->cache.inverseLF(here.first, here.second);
+  if(here.first == gbwt::ENDMARKER) { here = gbwt::invalid_edge(); }
+  return edge_to_step(here);
+}
+
+bool
+CachedGBWTGraph::for_each_path_handle_impl(const std::function<bool(const path_handle_t&)>& iteratee) const
+{
+  return this->graph->for_each_path_handle(iteratee);
+}
+
+bool
+CachedGBWTGraph::for_each_step_on_handle_impl(const handle_t& handle,
+  const std::function<bool(const step_handle_t&)>& iteratee) const
+{
+  // Nothing to do without named paths.
+  if(this->graph->get_path_count() == 0) { return true; }
+
+  // Steps are only defined on the forward versions of the paths, so we look at
+  // both orientations of the node.
+  for(gbwt::node_type node : { handle_to_node(handle), gbwt::Node::reverse(handle_to_node(handle)) })
+  {
+    gbwt::SearchState state = this->cache.find(node);
+    for(gbwt::size_type offset = state.range.first; offset <= state.range.second; offset++)
+    {
+      gbwt::edge_type position(state.node, offset);
+      gbwt::size_type sequence_id = this->graph->index->locate(position);
+      if(gbwt::Path::is_reverse(sequence_id)) { continue; }
+      if(this->graph->id_to_path.count(gbwt::Path::id(sequence_id)) == 0) { continue; }
+      if(!iteratee(edge_to_step(position))) { return false; }
+    }
+  }
+
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+std::vector<CachedGBWTGraph>
+prewarmed_graphs(const GBWTGraph& graph, const std::vector<std::vector<nid_t>>& regions)
+{
+  std::vector<CachedGBWTGraph> result(regions.size());
+  #pragma omp parallel for schedule(dynamic, 1)
+  for(size_t i = 0; i < regions.size(); i++)
+  {
+    result[i] = CachedGBWTGraph(graph);
+    result[i].prewarm(regions[i]);
+  }
+  return result;
+}
+
 //------------------------------------------------------------------------------
 
 } // namespace gbwtgraph
@@ -1,6 +1,9 @@
 #include <gbwtgraph/gbwtgraph.h>
 
 #include <algorithm>
+#include <atomic>
+#include <cstring>
+#include <limits>
 #include <queue>
 #include <stack>
 #include <string>
@@ -18,6 +21,7 @@ namespace gbwtgraph
 // Numerical class constants.
 
 constexpr size_t GBWTGraph::CHUNK_SIZE;
+constexpr std::uint16_t GBWTGraph::DEGREE_UNKNOWN;
 
 constexpr std::uint32_t GBWTGraph::Header::TAG;
 constexpr std::uint32_t GBWTGraph::Header::VERSION;
@@ -115,6 +119,10 @@ GBWTGraph::swap(GBWTGraph& another)
   std::swap(this->header, another.header);
   this->sequences.swap(another.sequences);
   this->real_nodes.swap(another.real_nodes);
+  std::swap(this->statistics, another.statistics);
+  this->node_records.swap(another.node_records);
+  this->unique_sequences.swap(another.unique_sequences);
+  this->sequence_ids.swap(another.sequence_ids);
   this->segments.swap(another.segments);
   this->node_to_segment.swap(another.node_to_segment);
   this->named_paths.swap(another.named_paths);
@@ -139,6 +147,10 @@ GBWTGraph::operator=(GBWTGraph&& source)
     this->header = std::move(source.header);
     this->sequences = std::move(source.sequences);
     this->real_nodes = std::move(source.real_nodes);
+    this->statistics = std::move(source.statistics);
+    this->node_records = std::move(source.node_records);
+    this->unique_sequences = std::move(source.unique_sequences);
+    this->sequence_ids = std::move(source.sequence_ids);
     this->segments = std::move(source.segments);
     this->node_to_segment = std::move(source.node_to_segment);
     this->named_paths = std::move(source.named_paths);
@@ -156,6 +168,10 @@ GBWTGraph::copy(const GBWTGraph& source)
   this->header = source.header;
   this->sequences = source.sequences;
   this->real_nodes = source.real_nodes;
+  this->statistics = source.statistics;
+  this->node_records = source.node_records;
+  this->unique_sequences = source.unique_sequences;
+  this->sequence_ids = source.sequence_ids;
   this->segments = source.segments;
   this->node_to_segment = source.node_to_segment;
   this->named_paths = source.named_paths;
@@ -173,9 +189,9 @@ GBWTGraph::sanity_checks()
     throw sdsl::simple_sds::InvalidData("GBWTGraph: Invalid number of set bits in real_nodes");
   }
 
-  size_t potential_nodes = this->sequences.size();
+  size_t potential_nodes = this->stored_sequences();
   if(this->index != nullptr && !(this->index->empty())) { potential_nodes =  this->index->sigma() - this->index->firstNode(); }
-  if(this->sequences.size() != potential_nodes)
+  if(this->stored_sequences() != potential_nodes)
   {
     throw sdsl::simple_sds::InvalidData("GBWTGraph: Node range / sequence count mismatch");
   }
@@ -238,7 +254,7 @@ GBWTGraph::copy_translation(const NamedNodeBackTranslation& translation) const
     else
     {
       // Translate it back to a segment range.
-      size_t node_length = this->sequences.length(this->node_offset(node));
+      size_t node_length = this->stored_length(this->node_offset(node));
       oriented_node_range_t range{node_id, false, 0, node_length};
       auto translated_back = translation.translate_back(range);
       if(translated_back.size() != 1)
@@ -329,6 +345,7 @@ GBWTGraph::GBWTGraph(const gbwt::GBWT& gbwt_index,
     handle_t handle = sequence_source.get_handle(id, gbwt::Node::is_reverse(node));
     return sequence_source.get_sequence(handle);
   });
+  this->compute_statistics();
 
   // Store the node to segment translation
   if(segment_space)
@@ -367,6 +384,7 @@ GBWTGraph::GBWTGraph(const gbwt::GBWT& gbwt_index, const SequenceSource& sequenc
     if(gbwt::Node::is_reverse(node)) { reverse_complement_in_place(result); }
     return result;
   });
+  this->compute_statistics();
 
   // Store the node to segment translation but leave the names of unused segments empty.
   if(sequence_source.uses_translation())
@@ -406,6 +424,46 @@ GBWTGraph::determine_real_nodes()
   }
 }
 
+void
+GBWTGraph::compute_statistics()
+{
+  this->statistics = Statistics();
+  if(this->index == nullptr || this->index->empty() || this->header.nodes == 0) { return; }
+
+  size_t edges = 0, total_length = 0;
+  size_t min_length = std::numeric_limits<size_t>::max(), max_length = 0;
+  #pragma omp parallel reduction(+:edges, total_length) reduction(min:min_length) reduction(max:max_length)
+  {
+    gbwt::CachedGBWT cache = this->get_single_cache();
+    #pragma omp for schedule(dynamic, CHUNK_SIZE)
+    for(gbwt::node_type node = this->index->firstNode(); node < this->index->sigma(); node += 2)
+    {
+      if(!(this->real_nodes[this->node_offset(node) / 2])) { continue; }
+      size_t length = this->stored_length(this->node_offset(node));
+      total_length += length;
+      min_length = std::min(min_length, length);
+      max_length = std::max(max_length, length);
+
+      // Edge (from, to) is the same as (reverse(to), reverse(from)). Like
+      // libhandlegraph, we count it in the orientation with the smaller from.
+      for(gbwt::node_type from : { node, gbwt::Node::reverse(node) })
+      {
+        gbwt::size_type cache_index = cache.findRecord(from);
+        for(gbwt::rank_type outrank = 0; outrank < cache.outdegree(cache_index); outrank++)
+        {
+          gbwt::node_type to = cache.successor(cache_index, outrank);
+          if(to != gbwt::ENDMARKER && from <= gbwt::Node::reverse(to)) { edges++; }
+        }
+      }
+    }
+  }
+
+  this->statistics.edges = edges;
+  this->statistics.total_length = total_length;
+  this->statistics.min_length = min_length;
+  this->statistics.max_length = max_length;
+}
+
 void
 GBWTGraph::cache_named_paths()
 {
@@ -480,7 +538,12 @@ GBWTGraph::cache_named_paths()
 bool
 GBWTGraph::has_node(nid_t node_id) const
 {
-  size_t offset = this->node_offset(gbwt::Node::encode(node_id, false)) / 2;
+  size_t offset = this->node_offset(gbwt::Node::encode(node_id, false));
+  if(this->has_node_records())
+  {
+    return (offset < this->node_records.size() && this->node_records[offset].present);
+  }
+  offset /= 2;
   return (offset < this->real_nodes.size() && this->real_nodes[offset]);
 }
 
@@ -512,21 +575,23 @@ size_t
 GBWTGraph::get_length(const handle_t& handle) const
 {
   size_t offset = this->node_offset(handle);
-  return this->sequences.length(offset);
+  if(this->has_node_records()) { return this->node_records[offset].length; }
+  return this->stored_length(offset);
 }
 
 std::string
 GBWTGraph::get_sequence(const handle_t& handle) const
 {
   size_t offset = this->node_offset(handle);
-  return this->sequences.str(offset);
+  view_type view = this->node_view(offset);
+  return std::string(view.first, view.second);
 }
 
 char
 GBWTGraph::get_base(const handle_t& handle, size_t index) const
 {
   size_t offset = this->node_offset(handle);
-  view_type view = this->sequences.view(offset);
+  view_type view = this->node_view(offset);
   return *(view.first + index);
 }
 
@@ -534,7 +599,7 @@ std::string
 GBWTGraph::get_subsequence(const handle_t& handle, size_t index, size_t size) const
 {
   size_t offset = this->node_offset(handle);
-  view_type view = this->sequences.view(offset);
+  view_type view = this->node_view(offset);
   index = std::min(index, view.second);
   size = std::min(size, view.second - index);
   return std::string(view.first + index, view.first + index + size);
@@ -568,36 +633,21 @@ GBWTGraph::follow_edges_impl(const handle_t& handle, bool go_left, const std::fu
 bool
 GBWTGraph::for_each_handle_impl(const std::function<bool(const handle_t&)>& iteratee, bool parallel) const
 {
-  if(parallel)
-  {
-    #pragma omp parallel for schedule(dynamic, CHUNK_SIZE)
-    for(gbwt::node_type node = this->index->firstNode(); node < this->index->sigma(); node += 2)
-    {
-      if(!(this->real_nodes[this->node_offset(node) / 2])) { continue; }
-      if(!iteratee(node_to_handle(node)))
-      {
-        // We should stop early but it's not worth the effort.
-      }
-    }
-  }
-  else
-  {
-    for(gbwt::node_type node = this->index->firstNode(); node < this->index->sigma(); node += 2)
-    {
-      if(!(this->real_nodes[this->node_offset(node) / 2])) { continue; }
-      if(!iteratee(node_to_handle(node))) { return false; }
-    }
-  }
-
-  return true;
+  return this->for_each_node(iteratee, parallel);
 }
 
 size_t
 GBWTGraph::get_degree(const handle_t& handle, bool go_left) const
 {
-  // Cache the node.
   gbwt::node_type curr = handle_to_node(handle);
   if(go_left) { curr = gbwt::Node::reverse(curr); }
+  if(this->has_node_records())
+  {
+    std::uint16_t outdegree = this->node_records[this->node_offset(curr)].outdegree;
+    if(outdegree != DEGREE_UNKNOWN) { return outdegree; }
+  }
+
+  // Cache the node.
   gbwt::CachedGBWT cache = this->get_single_cache();
   gbwt::size_type cache_index = cache.findRecord(curr);
 
@@ -625,6 +675,75 @@ GBWTGraph::has_edge(const handle_t& left, const handle_t& right) const
   return false;
 }
 
+bool
+GBWTGraph::for_each_edge_impl(const std::function<bool(const edge_t&)>& iteratee, bool parallel) const
+{
+  if(this->index == nullptr || this->index->empty()) { return true; }
+
+  // Right edges from the forward orientation are canonical if the destination has
+  // a greater or equal id. Right edges from the reverse orientation are canonical if
+  // the destination has a greater id or if the edge is a self-loop to the forward
+  // orientation of the node.
+  auto edges_from = [&](const gbwt::CachedGBWT& cache, gbwt::node_type node) -> bool
+  {
+    nid_t id = gbwt::Node::id(node);
+    for(gbwt::node_type from : { node, gbwt::Node::reverse(node) })
+    {
+      handle_t from_handle = node_to_handle(from);
+      gbwt::size_type cache_index = cache.findRecord(from);
+      for(gbwt::rank_type outrank = 0; outrank < cache.outdegree(cache_index); outrank++)
+      {
+        gbwt::node_type to = cache.successor(cache_index, outrank);
+        if(to == gbwt::ENDMARKER) { continue; }
+        nid_t to_id = gbwt::Node::id(to);
+        bool canonical = (gbwt::Node::is_reverse(from) ?
+                          (to_id > id || (to_id == id && !(gbwt::Node::is_reverse(to)))) :
+                          (to_id >= id));
+        if(canonical && !iteratee(edge_t(from_handle, node_to_handle(to)))) { return false; }
+      }
+    }
+    return true;
+  };
+
+  if(parallel)
+  {
+    std::atomic<bool> keep_going(true);
+    #pragma omp parallel
+    {
+      gbwt::CachedGBWT cache = this->get_single_cache();
+      #pragma omp for schedule(dynamic, CHUNK_SIZE)
+      for(gbwt::node_type node = this->index->firstNode(); node < this->index->sigma(); node += 2)
+      {
+        if(!keep_going || !(this->real_nodes[this->node_offset(node) / 2])) { continue; }
+        if(!edges_from(cache, node)) { keep_going = false; }
+      }
+    }
+    return keep_going;
+  }
+  else
+  {
+    gbwt::CachedGBWT cache = this->get_single_cache();
+    for(gbwt::node_type node = this->index->firstNode(); node < this->index->sigma(); node += 2)
+    {
+      if(!(this->real_nodes[this->node_offset(node) / 2])) { continue; }
+      if(!edges_from(cache, node)) { return false; }
+    }
+    return true;
+  }
+}
+
+size_t
+GBWTGraph::get_edge_count() const
+{
+  return this->statistics.edges;
+}
+
+size_t
+GBWTGraph::get_total_length() const
+{
+  return this->statistics.total_length;
+}
+
 //------------------------------------------------------------------------------
 
 size_t
@@ -1607,7 +1726,7 @@ GBWTGraph::get_segment_name_and_offset(const handle_t& handle) const
     start = this->node_offset(gbwt::Node::encode(iter->second, false));
     limit = this->node_offset(gbwt::Node::encode(id, false));
   }
-  size_t offset = this->sequences.length(start, limit) / 2;
+  size_t offset = this->stored_length(start, limit) / 2;
 
   return std::pair<std::string, size_t>(this->segments.str(iter->first), offset);
 }
@@ -1644,7 +1763,7 @@ GBWTGraph::get_segment_offset(const handle_t& handle) const
     start = this->node_offset(gbwt::Node::encode(iter->second, false));
     limit = this->node_offset(gbwt::Node::encode(id, false));
   }
-  size_t offset = this->sequences.length(start, limit) / 2;
+  size_t offset = this->stored_length(start, limit) / 2;
 
   return offset;
 }
@@ -1759,7 +1878,7 @@ GBWTGraph::translate_back(const oriented_node_range_t& range) const {
     start = this->node_offset(gbwt::Node::encode(iter->second, false));
     limit = this->node_offset(gbwt::Node::encode(id, false));
   }
-  size_t offset = this->sequences.length(start, limit) / 2;
+  size_t offset = this->stored_length(start, limit) / 2;
 
   return {oriented_node_range_t(iter->first, std::get<1>(range), offset + std::get<2>(range), std::get<3>(range))};
 
@@ -1787,7 +1906,20 @@ GBWTGraph::serialize_members(std::ostream& out) const
 {
   out.write(reinterpret_cast<const char*>(&(this->header)), sizeof(Header));
 
-  this->sequences.serialize(out);
+  if(this->has_deduplicated_sequences())
+  {
+    gbwt::StringArray expanded(this->stored_sequences(),
+    [&](size_t offset) -> size_t
+    {
+      return this->stored_length(offset);
+    },
+    [&](size_t offset) -> view_type
+    {
+      return this->stored_view(offset);
+    });
+    expanded.serialize(out);
+  }
+  else { this->sequences.serialize(out); }
   this->real_nodes.serialize(out);
   if(this->header.get(Header::FLAG_TRANSLATION))
   {
@@ -1806,6 +1938,9 @@ GBWTGraph::deserialize_members(std::istream& in)
   h.unset(Header::FLAG_SIMPLE_SDS); // We only set this flag in the serialized header.
   h.set_version(); // Update to the current version.
   this->header = h;
+  this->clear_node_records();
+  this->unique_sequences = gbwt::StringArray();
+  this->sequence_ids = sdsl::int_vector<0>();
 
   // Load the graph.
   if(simple_sds)
@@ -1855,12 +1990,36 @@ GBWTGraph::deserialize_members(std::istream& in)
   }
 
   this->sanity_checks();
+
+  // With the SDSL format, the GBWT may be set before or after loading the graph.
+  // If the current GBWT does not match the graph, set_gbwt() computes the
+  // statistics later.
+  if(this->matches_gbwt()) { this->compute_statistics(); }
+  else { this->statistics = Statistics(); }
 }
 
 void
 GBWTGraph::set_gbwt(const gbwt::GBWT& gbwt_index)
+{
+  this->use_gbwt(gbwt_index);
+
+  // With the SDSL format, we may load the graph before setting the GBWT.
+  if(this->matches_gbwt()) { this->compute_statistics(); }
+}
+
+bool
+GBWTGraph::matches_gbwt() const
+{
+  if(this->index == nullptr) { return false; }
+  size_t potential_nodes = (this->index->empty() ? 0 : this->index->sigma() - this->index->firstNode());
+  return (this->stored_sequences() == potential_nodes && this->real_nodes.size() == potential_nodes / 2);
+}
+
+void
+GBWTGraph::use_gbwt(const gbwt::GBWT& gbwt_index)
 {
   this->index = &gbwt_index;
+  this->clear_node_records();
 
   if(!(this->index->bidirectional()))
   {
@@ -1890,14 +2049,14 @@ GBWTGraph::simple_sds_serialize(std::ostream& out) const
 
   // Compress the sequences. `real_nodes` can be rebuilt from the GBWT.
   {
-    gbwt::StringArray forward_only(this->sequences.size() / 2,
+    gbwt::StringArray forward_only(this->stored_sequences() / 2,
     [&](size_t offset) -> size_t
     {
-      return this->sequences.length(2 * offset);
+      return this->stored_length(2 * offset);
     },
     [&](size_t offset) -> view_type
     {
-      return this->sequences.view(2 * offset);
+      return this->stored_view(2 * offset);
     });
     forward_only.simple_sds_serialize(out);
   }
@@ -1910,8 +2069,9 @@ GBWTGraph::simple_sds_serialize(std::ostream& out) const
 void
 GBWTGraph::simple_sds_load(std::istream& in, const gbwt::GBWT& gbwt_index)
 {
-  // Set the GBWT so we can rebuild `real_nodes` later.
-  this->set_gbwt(gbwt_index);
+  // Set the GBWT so we can rebuild `real_nodes` later. The statistics are
+  // computed in deserialize_members() once the sequences have been loaded.
+  this->use_gbwt(gbwt_index);
 
   // The same deserialize() function can handle the SDSL and simple-sds formats.
   this->deserialize_members(in);
@@ -1924,14 +2084,14 @@ GBWTGraph::simple_sds_size() const
 
   // Compress the sequences.
   {
-    gbwt::StringArray forward_only(this->sequences.size() / 2,
+    gbwt::StringArray forward_only(this->stored_sequences() / 2,
     [&](size_t offset) -> size_t
     {
-      return this->sequences.length(2 * offset);
+      return this->stored_length(2 * offset);
     },
     [&](size_t offset) -> view_type
     {
-      return this->sequences.view(2 * offset);
+      return this->stored_view(2 * offset);
     });
     result += forward_only.simple_sds_size();
   }
@@ -1943,20 +2103,179 @@ GBWTGraph::simple_sds_size() const
   return result;
 }
 
+size_t
+GBWTGraph::advise_huge_pages() const
+{
+  size_t result = 0;
+  result += gbwtgraph::advise_huge_pages(this->sequences.strings.data(), this->sequences.strings.size());
+  result += gbwtgraph::advise_huge_pages(this->unique_sequences.strings.data(), this->unique_sequences.strings.size());
+  result += gbwtgraph::advise_huge_pages(this->sequence_ids.data(), this->sequence_ids.capacity() / gbwt::BYTE_BITS);
+  result += gbwtgraph::advise_huge_pages(this->real_nodes.data(), this->real_nodes.capacity() / gbwt::BYTE_BITS);
+  result += gbwtgraph::advise_huge_pages(this->node_records.data(), this->node_records.size() * sizeof(NodeRecord));
+  return result;
+}
+
+bool
+GBWTGraph::build_node_records()
+{
+  this->clear_node_records();
+  if(this->index == nullptr || this->index->empty() || this->header.nodes == 0) { return false; }
+
+  // Check that the lengths fit in the records.
+  size_t potential_nodes = this->index->sigma() - this->index->firstNode();
+  if(this->statistics.max_length > std::numeric_limits<std::uint32_t>::max()) { return false; }
+
+  std::vector<NodeRecord> records(potential_nodes);
+  #pragma omp parallel
+  {
+    gbwt::CachedGBWT cache = this->get_single_cache();
+    #pragma omp for schedule(dynamic, CHUNK_SIZE)
+    for(size_t offset = 0; offset < potential_nodes; offset++)
+    {
+      NodeRecord& record = records[offset];
+      view_type view = this->stored_view(offset);
+      record.offset = view.first - this->stored_data();
+      record.length = view.second;
+      record.outdegree = 0;
+      record.present = this->real_nodes[offset / 2];
+      record.padding = 0;
+      if(!(record.present)) { continue; }
+
+      // The outdegree reported by GBWT might account for the endmarker.
+      gbwt::size_type cache_index = cache.findRecord(offset + this->index->firstNode());
+      size_t outdegree = cache.outdegree(cache_index);
+      if(outdegree > 0 && cache.successor(cache_index, 0) == gbwt::ENDMARKER) { outdegree--; }
+      record.outdegree = (outdegree < DEGREE_UNKNOWN ? outdegree : DEGREE_UNKNOWN);
+    }
+  }
+  this->node_records = std::move(records);
+
+  return true;
+}
+
+namespace
+{
+
+// FNV-1a hash for node sequences.
+size_t
+sequence_hash(view_type view)
+{
+  size_t result = 0xCBF29CE484222325;
+  for(size_t i = 0; i < view.second; i++)
+  {
+    result ^= static_cast<unsigned char>(view.first[i]);
+    result *= 0x100000001B3;
+  }
+  return result;
+}
+
+bool
+same_sequence(view_type a, view_type b)
+{
+  return (a.second == b.second && std::equal(a.first, a.first + a.second, b.first));
+}
+
+} // anonymous namespace
+
+size_t
+GBWTGraph::deduplicate_sequences()
+{
+  size_t potential_nodes = this->stored_sequences();
+  if(this->has_deduplicated_sequences() || potential_nodes == 0) { return this->unique_sequences.size(); }
+
+  // Sort the node offsets by (hash, offset) so that identical sequences are in the
+  // same run and the first occurrence comes first.
+  std::vector<std::pair<size_t, size_t>> by_hash(potential_nodes);
+  #pragma omp parallel for schedule(dynamic, CHUNK_SIZE)
+  for(size_t offset = 0; offset < potential_nodes; offset++)
+  {
+    by_hash[offset] = std::make_pair(sequence_hash(this->sequences.view(offset)), offset);
+  }
+  gbwt::parallelQuickSort(by_hash.begin(), by_hash.end());
+
+  // Map each offset to the first offset with the same sequence. Hash collisions
+  // within a run are resolved by comparing the sequences.
+  std::vector<size_t> first_occurrence(potential_nodes);
+  for(size_t run_start = 0; run_start < by_hash.size(); )
+  {
+    size_t run_end = run_start + 1;
+    while(run_end < by_hash.size() && by_hash[run_end].first == by_hash[run_start].first) { run_end++; }
+    for(size_t i = run_start; i < run_end; i++)
+    {
+      size_t offset = by_hash[i].second;
+      first_occurrence[offset] = offset;
+      view_type view = this->sequences.view(offset);
+      for(size_t j = run_start; j < i; j++)
+      {
+        size_t candidate = by_hash[j].second;
+        if(first_occurrence[candidate] == candidate && same_sequence(this->sequences.view(candidate), view))
+        {
+          first_occurrence[offset] = candidate; break;
+        }
+      }
+    }
+    run_start = run_end;
+  }
+  std::vector<std::pair<size_t, size_t>>().swap(by_hash);
+
+  // Assign the slots in node offset order.
+  std::vector<size_t> slot_to_offset;
+  sdsl::int_vector<0> ids(potential_nodes, 0, sdsl::bits::length(potential_nodes));
+  for(size_t offset = 0; offset < potential_nodes; offset++)
+  {
+    if(first_occurrence[offset] == offset)
+    {
+      ids[offset] = slot_to_offset.size();
+      slot_to_offset.push_back(offset);
+    }
+    else { ids[offset] = ids[first_occurrence[offset]]; }
+  }
+  sdsl::util::bit_compress(ids);
+
+  gbwt::StringArray unique(slot_to_offset.size(),
+  [&](size_t slot) -> size_t
+  {
+    return this->sequences.length(slot_to_offset[slot]);
+  },
+  [&](size_t slot) -> view_type
+  {
+    return this->sequences.view(slot_to_offset[slot]);
+  });
+
+  // Node records point to the old sequence store.
+  bool had_records = this->has_node_records();
+  this->clear_node_records();
+  this->unique_sequences = std::move(unique);
+  this->sequence_ids = std::move(ids);
+  this->sequences = gbwt::StringArray();
+  if(had_records) { this->build_node_records(); }
+
+  return this->unique_sequences.size();
+}
+
+size_t
+GBWTGraph::stored_length(size_t start, size_t limit) const
+{
+  if(!(this->has_deduplicated_sequences())) { return this->sequences.length(start, limit); }
+  size_t result = 0;
+  for(size_t offset = start; offset < limit; offset++) { result += this->stored_length(offset); }
+  return result;
+}
+
 //------------------------------------------------------------------------------
 
 view_type
 GBWTGraph::get_sequence_view(const handle_t& handle) const
 {
   size_t offset = this->node_offset(handle);
-  return this->sequences.view(offset);
+  return this->node_view(offset);
 }
 
 bool
 GBWTGraph::starts_with(const handle_t& handle, char c) const
 {
   size_t offset = this->node_offset(handle);
-  view_type view = this->sequences.view(offset);
+  view_type view = this->node_view(offset);
   return (view.second > 0 && *view.first == c);
 }
 
@@ -1964,10 +2283,66 @@ bool
 GBWTGraph::ends_with(const handle_t& handle, char c) const
 {
   size_t offset = this->node_offset(handle);
-  view_type view = this->sequences.view(offset);
+  view_type view = this->node_view(offset);
   return (view.second > 0 && *(view.first + (view.second - 1)) == c);
 }
 
+size_t
+GBWTGraph::label_length(const std::vector<handle_t>& walk, size_t offset, size_t length) const
+{
+  size_t result = 0;
+  for(size_t i = 0; i < walk.size() && result < length; i++)
+  {
+    size_t node_length = this->get_length(walk[i]);
+    size_t start = (i == 0 ? std::min(offset, node_length) : 0);
+    result += std::min(node_length - start, length - result);
+  }
+  return result;
+}
+
+size_t
+GBWTGraph::write_label(const std::vector<handle_t>& walk, char* buffer, size_t offset, size_t length) const
+{
+  size_t result = 0;
+  for(size_t i = 0; i < walk.size() && result < length; i++)
+  {
+    view_type view = this->node_view(this->node_offset(walk[i]));
+    size_t start = (i == 0 ? std::min(offset, view.second) : 0);
+    size_t bases = std::min(view.second - start, length - result);
+    std::memcpy(buffer + result, view.first + start, bases);
+    result += bases;
+  }
+  return result;
+}
+
+std::vector<size_t>
+GBWTGraph::write_labels(const std::vector<std::vector<handle_t>>& walks, const std::vector<std::pair<size_t, size_t>>& bounds,
+                        std::string& arena, bool parallel) const
+{
+  auto get_bounds = [&](size_t i) -> std::pair<size_t, size_t>
+  {
+    if(bounds.empty()) { return std::pair<size_t, size_t>(0, std::numeric_limits<size_t>::max()); }
+    return bounds[i];
+  };
+
+  std::vector<size_t> starts(walks.size() + 1, 0);
+  for(size_t i = 0; i < walks.size(); i++)
+  {
+    std::pair<size_t, size_t> interval = get_bounds(i);
+    starts[i + 1] = starts[i] + this->label_length(walks[i], interval.first, interval.second);
+  }
+
+  arena.resize(starts.back());
+  #pragma omp parallel for schedule(dynamic, CHUNK_SIZE) if(parallel)
+  for(size_t i = 0; i < walks.size(); i++)
+  {
+    std::pair<size_t, size_t> interval = get_bounds(i);
+    this->write_label(walks[i], &arena[0] + starts[i], interval.first, interval.second);
+  }
+
+  return starts;
+}
+
 gbwt::SearchState
 GBWTGraph::find(const std::vector<handle_t>& path) const
 {
@@ -2022,57 +2397,21 @@ bool
 GBWTGraph::follow_paths(const gbwt::CachedGBWT& cache, gbwt::SearchState state,
                         const std::function<bool(const gbwt::SearchState&)>& iteratee) const
 {
-  gbwt::size_type cache_index = cache.findRecord(state.node);
-  for(gbwt::rank_type outrank = 0; outrank < cache.outdegree(cache_index); outrank++)
-  {
-    if(cache.successor(cache_index, outrank) == gbwt::ENDMARKER) { continue; }
-    gbwt::SearchState next_state = cache.cachedExtend(state, cache_index, outrank);
-    if(next_state.empty()) { continue; }
-    if(!iteratee(next_state)) { return false; }
-  }
-
-  return true;
+  return this->for_each_extension(cache, state, iteratee);
 }
 
 bool
 GBWTGraph::follow_paths(const gbwt::CachedGBWT& cache, gbwt::BidirectionalState state, bool backward,
                         const std::function<bool(const gbwt::BidirectionalState&)>& iteratee) const
 {
-  gbwt::size_type cache_index = cache.findRecord(backward ? state.backward.node : state.forward.node);
-  for(gbwt::rank_type outrank = 0; outrank < cache.outdegree(cache_index); outrank++)
-  {
-    if(cache.successor(cache_index, outrank) == gbwt::ENDMARKER) { continue; }
-    gbwt::BidirectionalState next_state = (backward ? cache.cachedExtendBackward(state, cache_index, outrank) :  cache.cachedExtendForward(state, cache_index, outrank));
-    if(next_state.empty()) { continue; }
-    if(!iteratee(next_state)) { return false; }
-  }
-
-  return true;
+  return this->for_each_extension(cache, state, backward, iteratee);
 }
 
 bool
 GBWTGraph::cached_follow_edges(const gbwt::CachedGBWT& cache, const handle_t& handle, bool go_left,
                                const std::function<bool(const handle_t&)>& iteratee) const
 {
-  // Incoming edges correspond to the outgoing edges of the reverse node.
-  gbwt::node_type curr = handle_to_node(handle);
-  if(go_left) { curr = gbwt::Node::reverse(curr); }
-
-  // Cache the node.
-  gbwt::size_type cache_index = cache.findRecord(curr);
-
-  for(gbwt::rank_type outrank = 0; outrank < cache.outdegree(cache_index); outrank++)
-  {
-    gbwt::node_type next = cache.successor(cache_index, outrank);
-    if(next == gbwt::ENDMARKER) { continue; }
-
-    // If we started from the reverse node, we must reverse the successor nodes to get
-    // the predecessor nodes of the original node.
-    if(go_left) { next = gbwt::Node::reverse(next); }
-    if(!iteratee(node_to_handle(next))) { return false; }
-  }
-
-  return true;
+  return this->for_each_successor(cache, handle, go_left, iteratee);
 }
 
 //------------------------------------------------------------------------------
@@ -2102,13 +2441,8 @@ struct GBWTTraversal
 
   std::string get_sequence(const GBWTGraph& graph) const
   {
-    std::string result;
-    result.reserve(this->length);
-    for(handle_t handle : this->traversal)
-    {
-      auto view = graph.get_sequence_view(handle);
-      result.append(view.first, std::min(view.second, this->length - result.length()));
-    }
+    std::string result(this->length, '\0');
+    graph.write_label(this->traversal, &result[0], 0, this->length);
     return result;
   }
 };
@@ -2118,8 +2452,21 @@ for_each_haplotype_window(const GBWTGraph& graph, size_t window_size,
                           const std::function<void(const std::vector<handle_t>&, const std::string&)>& lambda,
                           bool parallel)
 {
-  // Traverse all starting nodes in parallel.
-  graph.for_each_handle([&](const handle_t& h) -> bool
+  for_each_haplotype_window(graph, window_size,
+    [&](const std::vector<handle_t>& traversal, const std::string& seq, const gbwt::SearchState&)
+  {
+    lambda(traversal, seq);
+  }, parallel);
+}
+
+void
+for_each_haplotype_window(const GBWTGraph& graph, size_t window_size,
+                          const std::function<void(const std::vector<handle_t>&, const std::string&, const gbwt::SearchState&)>& lambda,
+                          bool parallel)
+{
+  // Traverse all starting nodes in parallel. The template interface avoids
+  // std::function calls in the inner loops.
+  graph.for_each_node([&](const handle_t& h) -> bool
   {
     // Get a GBWT cache.
     gbwt::CachedGBWT cache = graph.get_cache();
@@ -2144,13 +2491,13 @@ for_each_haplotype_window(const GBWTGraph& graph, size_t window_size,
       // Report the full window.
       if(window.length >= target_length)
       {
-        lambda(window.traversal, window.get_sequence(graph));
+        lambda(window.traversal, window.get_sequence(graph), window.state);
         continue;
       }
 
       // Try to extend the window to all successor nodes.
       bool extend_success = false;
-      graph.follow_paths(cache, window.state, [&](const gbwt::SearchState& next_state) -> bool
+      graph.for_each_extension(cache, window.state, [&](const gbwt::SearchState& next_state) -> bool
       {
         handle_t next_handle = GBWTGraph::node_to_handle(next_state.node);
         GBWTTraversal next_window = window;
@@ -2165,7 +2512,7 @@ for_each_haplotype_window(const GBWTGraph& graph, size_t window_size,
       // Report sufficiently long kmers that cannot be extended.
       if(!extend_success && window.length >= window_size)
       {
-        lambda(window.traversal, window.get_sequence(graph));
+        lambda(window.traversal, window.get_sequence(graph), window.state);
       }
     }
 
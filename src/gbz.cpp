@@ -1,5 +1,13 @@
 #include <gbwtgraph/gbz.h>
 
+#include <istream>
+#include <streambuf>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
 namespace gbwtgraph
 {
 
@@ -249,14 +257,122 @@ GBZ::serialize_to_files(const std::string& gbwt_name, const std::string& graph_n
   else { this->graph.serialize(graph_name); }
 }
 
+// A read-only memory-mapped file exposed as an input stream buffer.
+struct MappedFileBuffer : public std::streambuf
+{
+  MappedFileBuffer(const std::string& filename);
+  ~MappedFileBuffer();
+
+  MappedFileBuffer(const MappedFileBuffer&) = delete;
+  MappedFileBuffer& operator=(const MappedFileBuffer&) = delete;
+
+  const char* begin() const { return this->ptr; }
+  size_t size() const { return this->file_size; }
+
+  pos_type seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which) override;
+  pos_type seekpos(pos_type pos, std::ios_base::openmode which) override;
+
+  int    fd;
+  size_t file_size;
+  char*  ptr;
+};
+
+MappedFileBuffer::MappedFileBuffer(const std::string& filename) :
+  fd(-1), file_size(0), ptr(nullptr)
+{
+  this->fd = ::open(filename.c_str(), O_RDONLY);
+  if(this->fd < 0)
+  {
+    throw std::runtime_error("MappedFileBuffer: Cannot open file " + filename);
+  }
+
+  struct stat st;
+  if(::fstat(this->fd, &st) < 0)
+  {
+    ::close(this->fd);
+    throw std::runtime_error("MappedFileBuffer: Cannot stat file " + filename);
+  }
+  this->file_size = st.st_size;
+  if(this->file_size == 0)
+  {
+    ::close(this->fd);
+    throw std::runtime_error("MappedFileBuffer: File " + filename + " is empty");
+  }
+
+  void* temp_ptr = ::mmap(nullptr, this->file_size, PROT_READ, MAP_FILE | MAP_SHARED, this->fd, 0);
+  if(temp_ptr == MAP_FAILED)
+  {
+    ::close(this->fd);
+    throw std::runtime_error("MappedFileBuffer: Cannot memory map file " + filename);
+  }
+  ::madvise(temp_ptr, this->file_size, MADV_SEQUENTIAL); // We read the file once from start to end.
+  this->ptr = static_cast<char*>(temp_ptr);
+  this->setg(this->ptr, this->ptr, this->ptr + this->file_size);
+}
+
+MappedFileBuffer::~MappedFileBuffer()
+{
+  if(this->ptr != nullptr)
+  {
+    ::munmap(static_cast<void*>(this->ptr), this->file_size);
+  }
+  if(this->fd >= 0)
+  {
+    ::close(this->fd);
+  }
+}
+
+MappedFileBuffer::pos_type
+MappedFileBuffer::seekoff(off_type off, std::ios_base::seekdir dir, std::ios_base::openmode which)
+{
+  off_type base = 0;
+  if(dir == std::ios_base::cur) { base = this->gptr() - this->eback(); }
+  else if(dir == std::ios_base::end) { base = this->file_size; }
+  return this->seekpos(pos_type(base + off), which);
+}
+
+MappedFileBuffer::pos_type
+MappedFileBuffer::seekpos(pos_type pos, std::ios_base::openmode which)
+{
+  off_type offset = pos;
+  if(!(which & std::ios_base::in) || offset < 0 || offset > off_type(this->file_size))
+  {
+    return pos_type(off_type(-1));
+  }
+  this->setg(this->ptr, this->ptr + offset, this->ptr + this->file_size);
+  return pos;
+}
+
+// Returns true if the memory-mapped graph file starts with a simple-sds header.
+// The libhandlegraph / SDSL format starts with the magic number instead.
+bool
+is_simple_sds_graph(const MappedFileBuffer& buffer)
+{
+  if(buffer.size() < sizeof(GBWTGraph::Header)) { return false; }
+  const GBWTGraph::Header* header = reinterpret_cast<const GBWTGraph::Header*>(buffer.begin());
+  return (header->tag == GBWTGraph::Header::TAG && header->get(GBWTGraph::Header::FLAG_SIMPLE_SDS));
+}
+
 void
 GBZ::load_from_files(const std::string& gbwt_name, const std::string& graph_name)
 {
   this->tags.clear();
   this->add_source();
   sdsl::simple_sds::load_from(this->index, gbwt_name);
-  this->set_gbwt();
-  this->graph.deserialize(graph_name);
+
+  MappedFileBuffer buffer(graph_name);
+  std::istream in(&buffer);
+  in.exceptions(std::istream::failbit | std::istream::badbit);
+  if(is_simple_sds_graph(buffer))
+  {
+    // This also sets the GBWT.
+    this->graph.simple_sds_load(in, this->index);
+  }
+  else
+  {
+    this->set_gbwt();
+    this->graph.deserialize(in);
+  }
 }
 
 //------------------------------------------------------------------------------
@@ -0,0 +1,558 @@
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <unordered_set>
+#include <vector>
+
+#include <getopt.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/un.h>
+
+#include <gbwtgraph/gbz.h>
+
+using namespace gbwtgraph;
+
+//------------------------------------------------------------------------------
+
+const std::string tool_name = "GBZ Server";
+
+// Largest context accepted in subgraph queries.
+constexpr size_t MAX_CONTEXT = 1000;
+
+struct Config
+{
+  Config(int argc, char** argv);
+
+  bool client = false;
+  bool deduplicate = false;
+  bool huge_pages = false;
+  bool node_records = false;
+  bool show_progress = false;
+
+  std::string graph_name;
+  std::string socket_name;
+};
+
+/*
+  Buffered line reader over a file descriptor. Lines are returned without the
+  newline. Returns false at end of file or on error.
+*/
+struct LineReader
+{
+  explicit LineReader(int fd) : fd(fd), start(0) {}
+
+  bool read_line(std::string& line);
+
+  int         fd;
+  std::string buffer;
+  size_t      start;
+};
+
+// Writes all data to the file descriptor. Returns false on failure.
+bool write_all(int fd, const std::string& data);
+
+void run_server(const Config& config);
+void run_client(const Config& config);
+
+//------------------------------------------------------------------------------
+
+int
+main(int argc, char** argv)
+{
+  Config config(argc, argv);
+  if(config.client) { run_client(config); }
+  else { run_server(config); }
+  return 0;
+}
+
+//------------------------------------------------------------------------------
+
+void
+printUsage(int exit_code)
+{
+  Version::print(std::cerr, tool_name);
+
+  std::cerr << "Usage: gbz_server [options] graph.gbz socket" << std::endl;
+  std::cerr << "       gbz_server -c socket < queries" << std::endl;
+  std::cerr << std::endl;
+  std::cerr << "Loads the graph once and serves queries over a Unix domain socket." << std::endl;
+  std::cerr << "Each query is a line, and the response is either \"OK\\tN\" followed by" << std::endl;
+  std::cerr << "N lines or \"ERROR\\tmessage\"." << std::endl;
+  std::cerr << std::endl;
+  std::cerr << "Queries:" << std::endl;
+  std::cerr << "  stats                 Graph statistics" << std::endl;
+  std::cerr << "  paths                 Path identifiers and names" << std::endl;
+  std::cerr << "  steps ID ...          Number of steps in each path" << std::endl;
+  std::cerr << "  sequence ID ...       Sequence of each node" << std::endl;
+  std::cerr << "  subgraph ID N         GFA subgraph within N edges of the node (N <= " << MAX_CONTEXT << ")" << std::endl;
+  std::cerr << "  quit                  Close the connection" << std::endl;
+  std::cerr << std::endl;
+  std::cerr << "Options:" << std::endl;
+  std::cerr << "  -c, --client          Send queries from stdin to a running server" << std::endl;
+  std::cerr << "  -d, --deduplicate     Store identical node sequences only once" << std::endl;
+  std::cerr << "  -H, --huge-pages      Use transparent huge pages for the node sequences" << std::endl;
+  std::cerr << "  -p, --progress        Show progress information" << std::endl;
+  std::cerr << "  -r, --node-records    Build node records for faster node accesses" << std::endl;
+  std::cerr << std::endl;
+
+  std::exit(exit_code);
+}
+
+//------------------------------------------------------------------------------
+
+Config::Config(int argc, char** argv)
+{
+  if(argc < 2) { printUsage(EXIT_SUCCESS); }
+
+  // Data for `getopt_long()`.
+  int c = 0, option_index = 0;
+  option long_options[] =
+  {
+    { "client", no_argument, 0, 'c' },
+    { "deduplicate", no_argument, 0, 'd' },
+    { "huge-pages", no_argument, 0, 'H' },
+    { "progress", no_argument, 0, 'p' },
+    { "node-records", no_argument, 0, 'r' },
+    { 0, 0, 0, 0 }
+  };
+
+  // Process options.
+  while((c = getopt_long(argc, argv, "cdHpr", long_options, &option_index)) != -1)
+  {
+    switch(c)
+    {
+    case 'c':
+      this->client = true;
+      break;
+    case 'd':
+      this->deduplicate = true;
+      break;
+    case 'H':
+      this->huge_pages = true;
+      break;
+    case 'p':
+      this->show_progress = true;
+      break;
+    case 'r':
+      this->node_records = true;
+      break;
+
+    case '?':
+      std::exit(EXIT_FAILURE);
+    default:
+      std::exit(EXIT_FAILURE);
+    }
+  }
+
+  // Sanity checks.
+  if(!(this->client))
+  {
+    if(optind >= argc) { printUsage(EXIT_FAILURE); }
+    this->graph_name = argv[optind]; optind++;
+  }
+  if(optind >= argc) { printUsage(EXIT_FAILURE); }
+  this->socket_name = argv[optind]; optind++;
+
+  if(this->socket_name.length() >= sizeof(sockaddr_un::sun_path))
+  {
+    std::cerr << "gbz_server: Socket name is too long: " << this->socket_name << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+}
+
+//------------------------------------------------------------------------------
+
+bool
+LineReader::read_line(std::string& line)
+{
+  while(true)
+  {
+    size_t end = this->buffer.find('\n', this->start);
+    if(end != std::string::npos)
+    {
+      line.assign(this->buffer, this->start, end - this->start);
+      this->start = end + 1;
+      return true;
+    }
+
+    // Discard the consumed part and read more data.
+    this->buffer.erase(0, this->start); this->start = 0;
+    char temp[4096];
+    ssize_t bytes = ::read(this->fd, temp, sizeof(temp));
+    if(bytes < 0 && errno == EINTR) { continue; }
+    if(bytes <= 0)
+    {
+      if(this->buffer.empty()) { return false; }
+      line = this->buffer; this->buffer.clear(); // Final line without a newline.
+      return true;
+    }
+    this->buffer.append(temp, bytes);
+  }
+}
+
+bool
+write_all(int fd, const std::string& data)
+{
+  const char* ptr = data.data();
+  size_t remaining = data.length();
+  while(remaining > 0)
+  {
+    ssize_t written = ::send(fd, ptr, remaining, MSG_NOSIGNAL);
+    if(written < 0 && errno == EINTR) { continue; }
+    if(written <= 0) { return false; }
+    ptr += written; remaining -= written;
+  }
+  return true;
+}
+
+//------------------------------------------------------------------------------
+
+// Query processing.
+
+std::string
+ok_response(const std::vector<std::string>& lines)
+{
+  std::string result = "OK\t" + std::to_string(lines.size()) + "\n";
+  for(const std::string& line : lines) { result += line; result.push_back('\n'); }
+  return result;
+}
+
+std::string
+error_response(const std::string& message)
+{
+  return "ERROR\t" + message + "\n";
+}
+
+bool
+parse_number(const std::string& token, size_t& result)
+{
+  if(token.empty() || !std::all_of(token.begin(), token.end(), [](char c) { return (c >= '0' && c <= '9'); })) { return false; }
+  try { result = std::stoul(token); }
+  catch(const std::logic_error&) { return false; }
+  return true;
+}
+
+std::string
+stats_query(const GBZ& gbz)
+{
+  std::vector<std::string> lines;
+  lines.push_back("nodes\t" + std::to_string(gbz.graph.get_node_count()));
+  lines.push_back("edges\t" + std::to_string(gbz.graph.get_edge_count()));
+  lines.push_back("sequence\t" + std::to_string(gbz.graph.get_total_length()));
+  lines.push_back("paths\t" + std::to_string(gbz.index.sequences() / 2));
+  return ok_response(lines);
+}
+
+std::string
+paths_query(const GBZ& gbz)
+{
+  std::vector<std::string> lines;
+  bool has_names = (gbz.index.hasMetadata() && gbz.index.metadata.hasPathNames());
+  for(gbwt::size_type path_id = 0; path_id < gbz.index.sequences() / 2; path_id++)
+  {
+    std::string line = std::to_string(path_id);
+    if(has_names)
+    {
+      PathSense sense = get_path_sense(gbz.index, path_id, gbz.graph.reference_samples);
+      line += "\t" + compose_path_name(gbz.index, path_id, sense);
+    }
+    lines.push_back(line);
+  }
+  return ok_response(lines);
+}
+
+std::string
+steps_query(const GBZ& gbz, const std::vector<std::string>& args)
+{
+  std::vector<std::string> lines;
+  for(const std::string& arg : args)
+  {
+    size_t path_id = 0;
+    if(!parse_number(arg, path_id) || path_id >= gbz.index.sequences() / 2)
+    {
+      return error_response("Invalid path identifier: " + arg);
+    }
+    gbwt::vector_type path = gbz.index.extract(gbwt::Path::encode(path_id, false));
+    lines.push_back(arg + "\t" + std::to_string(path.size()));
+  }
+  return ok_response(lines);
+}
+
+std::string
+sequence_query(const GBZ& gbz, const std::vector<std::string>& args)
+{
+  std::vector<std::string> lines;
+  for(const std::string& arg : args)
+  {
+    size_t node_id = 0;
+    if(!parse_number(arg, node_id) || !(gbz.graph.has_node(node_id)))
+    {
+      return error_response("Invalid node identifier: " + arg);
+    }
+    view_type view = gbz.graph.get_sequence_view(gbz.graph.get_handle(node_id, false));
+    lines.push_back(arg + "\t" + std::string(view.first, view.second));
+  }
+  return ok_response(lines);
+}
+
+std::string
+subgraph_query(const GBZ& gbz, const std::vector<std::string>& args)
+{
+  size_t start = 0, context = 0;
+  if(args.size() != 2 || !parse_number(args[0], start) || !parse_number(args[1], context))
+  {
+    return error_response("Usage: subgraph ID N");
+  }
+  if(!(gbz.graph.has_node(start))) { return error_response("Invalid node identifier: " + args[0]); }
+  if(context > MAX_CONTEXT) { return error_response("Context is too large: " + args[1]); }
+
+  // Breadth-first search from the start node.
+  std::unordered_set<nid_t> visited { static_cast<nid_t>(start) };
+  std::vector<nid_t> frontier { static_cast<nid_t>(start) };
+  for(size_t depth = 0; depth < context && !(frontier.empty()); depth++)
+  {
+    std::vector<nid_t> next_frontier;
+    for(nid_t id : frontier)
+    {
+      handle_t handle = gbz.graph.get_handle(id, false);
+      for(bool go_left : { false, true })
+      {
+        gbz.graph.follow_edges(handle, go_left, [&](const handle_t& next) -> bool
+        {
+          nid_t next_id = gbz.graph.get_id(next);
+          if(visited.insert(next_id).second) { next_frontier.push_back(next_id); }
+          return true;
+        });
+      }
+    }
+    frontier.swap(next_frontier);
+  }
+  std::vector<nid_t> nodes(visited.begin(), visited.end());
+  std::sort(nodes.begin(), nodes.end());
+
+  // Segments and the edges between them, each edge in its canonical orientation.
+  std::vector<std::string> lines;
+  for(nid_t id : nodes)
+  {
+    view_type view = gbz.graph.get_sequence_view(gbz.graph.get_handle(id, false));
+    lines.push_back("S\t" + std::to_string(id) + "\t" + std::string(view.first, view.second));
+  }
+  for(nid_t id : nodes)
+  {
+    for(bool is_reverse : { false, true })
+    {
+      handle_t from = gbz.graph.get_handle(id, is_reverse);
+      gbz.graph.follow_edges(from, false, [&](const handle_t& to) -> bool
+      {
+        gbwt::node_type from_node = GBWTGraph::handle_to_node(from), to_node = GBWTGraph::handle_to_node(to);
+        if(from_node > gbwt::Node::reverse(to_node) || visited.find(gbz.graph.get_id(to)) == visited.end()) { return true; }
+        lines.push_back("L\t" + std::to_string(id) + "\t" + (is_reverse ? "-" : "+") + "\t" +
+                        std::to_string(gbz.graph.get_id(to)) + "\t" + (gbz.graph.get_is_reverse(to) ? "-" : "+") + "\t0M");
+        return true;
+      });
+    }
+  }
+  return ok_response(lines);
+}
+
+// Returns the response to the query, or an empty string if the connection should be closed.
+std::string
+process_query(const GBZ& gbz, const std::string& query)
+{
+  std::istringstream in(query);
+  std::string command, token;
+  in >> command;
+  std::vector<std::string> args;
+  while(in >> token) { args.push_back(token); }
+
+  if(command == "quit") { return std::string(); }
+  if(command == "stats") { return stats_query(gbz); }
+  if(command == "paths") { return paths_query(gbz); }
+  if(command == "steps") { return steps_query(gbz, args); }
+  if(command == "sequence") { return sequence_query(gbz, args); }
+  if(command == "subgraph") { return subgraph_query(gbz, args); }
+  return error_response("Unknown query: " + command);
+}
+
+void
+serve_client(int fd, const GBZ& gbz)
+{
+  LineReader reader(fd);
+  std::string query;
+  while(reader.read_line(query))
+  {
+    if(query.empty()) { continue; }
+    std::string response;
+    try { response = process_query(gbz, query); }
+    catch(const std::exception& e) { response = error_response(e.what()); }
+    if(response.empty() || !write_all(fd, response)) { break; }
+  }
+  ::close(fd);
+}
+
+//------------------------------------------------------------------------------
+
+std::atomic<bool> interrupted(false);
+
+extern "C" void
+handle_signal(int)
+{
+  interrupted = true;
+}
+
+void
+run_server(const Config& config)
+{
+  if(config.show_progress)
+  {
+    Version::print(std::cerr, tool_name);
+    std::cerr << "Loading GBZ from " << config.graph_name << std::endl;
+  }
+  double start = gbwt::readTimer();
+  GBZ gbz;
+  sdsl::simple_sds::load_from(gbz, config.graph_name);
+  if(config.show_progress)
+  {
+    double seconds = gbwt::readTimer() - start;
+    std::cerr << "Loaded the graph in " << seconds << " seconds" << std::endl;
+  }
+  if(config.deduplicate)
+  {
+    size_t unique = gbz.graph.deduplicate_sequences();
+    if(config.show_progress)
+    {
+      std::cerr << "Deduplicated the sequences into " << unique << " distinct sequences" << std::endl;
+    }
+  }
+  if(config.node_records)
+  {
+    if(!(gbz.graph.build_node_records()))
+    {
+      std::cerr << "gbz_server: Could not build node records" << std::endl;
+    }
+    else if(config.show_progress)
+    {
+      std::cerr << "Built records for " << gbz.graph.node_records.size() << " node orientations" << std::endl;
+    }
+  }
+  if(config.huge_pages)
+  {
+    size_t bytes = gbz.graph.advise_huge_pages();
+    if(config.show_progress)
+    {
+      std::cerr << "Advised huge pages for " << bytes << " bytes" << std::endl;
+    }
+  }
+
+  // Replace a stale socket, but nothing else.
+  struct stat st;
+  if(::lstat(config.socket_name.c_str(), &st) == 0)
+  {
+    if(!S_ISSOCK(st.st_mode))
+    {
+      std::cerr << "gbz_server: " << config.socket_name << " exists and is not a socket" << std::endl;
+      std::exit(EXIT_FAILURE);
+    }
+    ::unlink(config.socket_name.c_str());
+  }
+
+  int server_fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if(server_fd < 0)
+  {
+    std::cerr << "gbz_server: Cannot create a socket: " << std::strerror(errno) << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, config.socket_name.c_str(), sizeof(address.sun_path) - 1);
+  if(::bind(server_fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0 || ::listen(server_fd, SOMAXCONN) < 0)
+  {
+    std::cerr << "gbz_server: Cannot listen to " << config.socket_name << ": " << std::strerror(errno) << std::endl;
+    ::close(server_fd);
+    std::exit(EXIT_FAILURE);
+  }
+
+  // Interrupt accept() on SIGINT / SIGTERM so that we can remove the socket.
+  struct sigaction action;
+  std::memset(&action, 0, sizeof(action));
+  action.sa_handler = handle_signal;
+  sigemptyset(&action.sa_mask);
+  ::sigaction(SIGINT, &action, nullptr);
+  ::sigaction(SIGTERM, &action, nullptr);
+
+  if(config.show_progress)
+  {
+    std::cerr << "Listening to " << config.socket_name << std::endl;
+  }
+  while(!interrupted)
+  {
+    int client_fd = ::accept(server_fd, nullptr, nullptr);
+    if(client_fd < 0)
+    {
+      if(errno == EINTR) { continue; }
+      std::cerr << "gbz_server: Cannot accept a connection: " << std::strerror(errno) << std::endl;
+      break;
+    }
+    // The graph is immutable, so the connections can share it without locking.
+    std::thread(serve_client, client_fd, std::cref(gbz)).detach();
+  }
+
+  ::close(server_fd);
+  ::unlink(config.socket_name.c_str());
+  if(config.show_progress)
+  {
+    std::cerr << "Server stopped" << std::endl;
+  }
+  // Detached threads may still be using the graph, so we do not return from main().
+  std::_Exit(EXIT_SUCCESS);
+}
+
+//------------------------------------------------------------------------------
+
+void
+run_client(const Config& config)
+{
+  int fd = ::socket(AF_UNIX, SOCK_STREAM, 0);
+  if(fd < 0)
+  {
+    std::cerr << "gbz_server: Cannot create a socket: " << std::strerror(errno) << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
+  sockaddr_un address;
+  std::memset(&address, 0, sizeof(address));
+  address.sun_family = AF_UNIX;
+  std::strncpy(address.sun_path, config.socket_name.c_str(), sizeof(address.sun_path) - 1);
+  if(::connect(fd, reinterpret_cast<sockaddr*>(&address), sizeof(address)) < 0)
+  {
+    std::cerr << "gbz_server: Cannot connect to " << config.socket_name << ": " << std::strerror(errno) << std::endl;
+    ::close(fd);
+    std::exit(EXIT_FAILURE);
+  }
+
+  LineReader reader(fd);
+  std::string query, line;
+  while(std::getline(std::cin, query))
+  {
+    if(query.empty()) { continue; }
+    if(!write_all(fd, query + "\n")) { break; }
+    if(query == "quit" || !reader.read_line(line)) { break; }
+    std::cout << line << std::endl;
+    size_t lines = 0;
+    if(line.compare(0, 3, "OK\t") == 0) { lines = std::stoul(line.substr(3)); }
+    for(size_t i = 0; i < lines && reader.read_line(line); i++) { std::cout << line << std::endl; }
+  }
+  ::close(fd);
+}
+
+//------------------------------------------------------------------------------
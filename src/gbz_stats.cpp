@@ -1,8 +1,12 @@
 #include <iostream>
 #include <fstream>
+#include <cstdio>
 #include <map>
+#include <string>
+#include <vector>
 
 #include <getopt.h>
+#include <omp.h>
 #include <unistd.h>
 
 #include <gbwtgraph/gbz.h>
@@ -13,6 +17,9 @@ using namespace gbwtgraph;
 
 const std::string tool_name = "GBZ Statistics";
 
+// Number of GBWT nodes processed by a thread at a time.
+constexpr size_t NODE_BLOCK_SIZE = 1024;
+
 struct Config
 {
   Config(int argc, char** argv);
@@ -25,11 +32,66 @@ struct Config
 
   bool record_bytes = false;
   bool record_runs = false;
+  size_t region_size = 0;
+
+  bool path_lengths = false;
+  bool sample_steps = false;
+
+  bool json = false;
 
   std::string filename;
+
+  bool node_pass() const
+  {
+    return (this->node_degrees || this->node_visits || this->record_bytes || this->record_runs || this->region_size > 0);
+  }
+
+  bool path_pass() const { return (this->path_lengths || this->sample_steps); }
+};
+
+/*
+  Partial statistics computed by a single thread. Each thread updates its own
+  instance, and the instances are merged after the parallel pass.
+*/
+struct Statistics
+{
+  // Distributions.
+  std::map<size_t, size_t> node_degrees, node_visits;
+  std::map<size_t, size_t> record_bytes, record_runs;
+  std::map<size_t, size_t> path_lengths;
+
+  // Compressed record bytes and record counts by node id region.
+  std::vector<size_t> region_bytes, region_records;
+
+  // Path and step counts by sample identifier.
+  std::vector<size_t> sample_paths, sample_steps;
+
+  void merge(const Statistics& another);
+};
+
+/*
+  Statistics output in either human-readable TSV or machine-readable JSON. In
+  the JSON format, each report becomes a field of a single top-level object.
+*/
+struct Report
+{
+  explicit Report(bool json);
+  ~Report();
+
+  void value(const std::string& key, const std::string& header, size_t value);
+  void flag(const std::string& key, const std::string& header, bool value);
+  void distribution(const std::string& key, const std::map<size_t, size_t>& distribution, const std::string& header1, const std::string& header2);
+  void table(const std::string& key, const std::vector<std::string>& headers, const std::vector<std::vector<std::string>>& rows, size_t text_columns);
+
+  // Starts a field in the top-level JSON object.
+  void field(const std::string& key);
+
+  bool json;
+  size_t fields;
 };
 
-void print_distribution(const std::map<size_t, size_t>& distribution, const std::string& header1, const std::string& header2);
+void node_pass(const GBZ& gbz, const Config& config, Statistics& statistics);
+void path_pass(const GBZ& gbz, const Config& config, Statistics& statistics);
 
 //------------------------------------------------------------------------------
 
@@ -40,63 +102,99 @@ main(int argc, char** argv)
   GBZ gbz;
   sdsl::simple_sds::load_from(gbz, config.filename);
 
+  // Graph statistics are cached in the graph. Node and record statistics are
+  // computed in a single pass over the GBWT nodes, while path statistics
+  // require a separate pass over the paths.
+  Statistics statistics;
+  if(config.node_pass()) { node_pass(gbz, config, statistics); }
+  if(config.path_pass()) { path_pass(gbz, config, statistics); }
+
+  Report report(config.json);
+
   if(config.graph)
   {
-    std::cout << "Nodes\t" << gbz.graph.get_node_count() << std::endl;
-    std::cout << "Edges\t" << gbz.graph.get_edge_count() << std::endl;
-    size_t total_length = 0;
-    gbz.graph.for_each_handle([&](const handle_t& handle)
-    {
-      total_length += gbz.graph.get_length(handle);
-    });
-    std::cout << "Sequence\t" << total_length << std::endl;
+    report.value("nodes", "Nodes", gbz.graph.get_node_count());
+    report.value("edges", "Edges", gbz.graph.get_edge_count());
+    report.value("sequence", "Sequence", gbz.graph.get_total_length());
+    report.value("min_node_length", "Min node length", gbz.graph.min_node_length());
+    report.value("max_node_length", "Max node length", gbz.graph.max_node_length());
   }
 
   if(config.gbwt)
   {
-    gbwt::printStatistics(gbz.index, config.filename, std::cout);
+    if(config.json)
+    {
+      report.value("gbwt_total_length", "", gbz.index.size());
+      report.value("gbwt_sequences", "", gbz.index.sequences());
+      report.value("gbwt_alphabet_size", "", gbz.index.sigma());
+      report.value("gbwt_effective_alphabet_size", "", gbz.index.effective());
+      report.flag("gbwt_bidirectional", "", gbz.index.bidirectional());
+      if(gbz.index.hasMetadata())
+      {
+        report.value("gbwt_samples", "", gbz.index.metadata.samples());
+        report.value("gbwt_haplotypes", "", gbz.index.metadata.haplotypes());
+        report.value("gbwt_contigs", "", gbz.index.metadata.contigs());
+      }
+    }
+    else
+    {
+      gbwt::printStatistics(gbz.index, config.filename, std::cout);
+    }
   }
 
   if(config.node_degrees)
   {
-    std::map<size_t, size_t> distribution;
-    gbz.graph.for_each_handle([&](const handle_t& handle)
-    {
-      size_t degree = gbz.graph.get_degree(handle, false) + gbz.graph.get_degree(handle, true);
-      distribution[degree]++;
-    });
-    print_distribution(distribution, "Degree", "Nodes");
+    report.distribution("node_degrees", statistics.node_degrees, "Degree", "Nodes");
   }
 
   if(config.node_visits)
   {
-    std::map<size_t, size_t> distribution;
-    for(gbwt::node_type node = gbz.index.firstNode(); node < gbz.index.sigma(); node += 2)
-    {
-      distribution[gbz.index.nodeSize(node)]++;
-    }
-    print_distribution(distribution, "Visits", "Nodes");
+    report.distribution("node_visits", statistics.node_visits, "Visits", "Nodes");
   }
 
   if(config.record_bytes)
   {
-    std::map<size_t, size_t> distribution;
-    for(gbwt::node_type node = gbz.index.firstNode(); node < gbz.index.sigma(); node++)
+    report.distribution("record_bytes", statistics.record_bytes, "Bytes", "Records");
+  }
+
+  if(config.record_runs)
+  {
+    report.distribution("record_runs", statistics.record_runs, "Runs", "Records");
+  }
+
+  if(config.region_size > 0)
+  {
+    std::vector<std::vector<std::string>> rows;
+    nid_t first_id = gbwt::Node::id(gbz.index.firstNode());
+    for(size_t region = 0; region < statistics.region_bytes.size(); region++)
     {
-      std::pair<gbwt::size_type, gbwt::size_type> range = gbz.index.bwt.getRange(gbz.index.toComp(node));
-      distribution[range.second - range.first]++;
+      if(statistics.region_records[region] == 0) { continue; }
+      nid_t start = first_id + region * config.region_size;
+      rows.push_back(
+      {
+        std::to_string(start), std::to_string(start + config.region_size - 1),
+        std::to_string(statistics.region_records[region]), std::to_string(statistics.region_bytes[region])
+      });
     }
-    print_distribution(distribution, "Bytes", "Records");
+    report.table("region_bytes", { "First", "Last", "Records", "Bytes" }, rows, 0);
   }
 
-  if(config.record_runs)
+  if(config.path_lengths)
+  {
+    report.distribution("path_lengths", statistics.path_lengths, "Length", "Paths");
+  }
+
+  if(config.sample_steps && !(statistics.sample_steps.empty()))
   {
-    std::map<size_t, size_t> distribution;
-    for(gbwt::node_type node = gbz.index.firstNode(); node < gbz.index.sigma(); node++)
+    const gbwt::Metadata& metadata = gbz.index.metadata;
+    std::vector<std::vector<std::string>> rows;
+    for(size_t sample = 0; sample < statistics.sample_steps.size(); sample++)
     {
-      distribution[gbz.index.record(node).runs().first]++;
+      if(statistics.sample_paths[sample] == 0) { continue; }
+      std::string name = (metadata.hasSampleNames() ? metadata.sample(sample) : std::to_string(sample));
+      rows.push_back({ name, std::to_string(statistics.sample_paths[sample]), std::to_string(statistics.sample_steps[sample]) });
     }
-    print_distribution(distribution, "Runs", "Records");
+    report.table("sample_steps", { "Sample", "Paths", "Steps" }, rows, 1);
   }
 
   return 0;
@@ -112,16 +210,25 @@ printUsage(int exit_code)
   std::cerr << "Usage: gbz_stats [options] graph.gbz" << std::endl;
   std::cerr << std::endl;
   std::cerr << "Overall statistics:" << std::endl;
-  std::cerr << "  -g, --graph         Graph statistics" << std::endl;
-  std::cerr << "  -i, --gbwt          GBWT index statistics" << std::endl;
+  std::cerr << "  -g, --graph           Graph statistics" << std::endl;
+  std::cerr << "  -i, --gbwt            GBWT index statistics" << std::endl;
   std::cerr << std::endl;
   std::cerr << "Nodes:" << std::endl;
-  std::cerr << "  -d, --node-degrees  Node degree distribution" << std::endl;
-  std::cerr << "  -v, --node-visits   Node visit distribution" << std::endl;
+  std::cerr << "  -d, --node-degrees    Node degree distribution" << std::endl;
+  std::cerr << "  -v, --node-visits     Node visit distribution" << std::endl;
   std::cerr << std::endl;
   std::cerr << "GBWT records:" << std::endl;
-  std::cerr << "  -b, --record-bytes  Record size distribution" << std::endl;
-  std::cerr << "  -r, --record-runs   Run count distribution" << std::endl;
+  std::cerr << "  -b, --record-bytes    Record size distribution" << std::endl;
+  std::cerr << "  -r, --record-runs     Run count distribution" << std::endl;
+  std::cerr << "  -R, --region-bytes N  Record sizes in regions of N node identifiers" << std::endl;
+  std::cerr << std::endl;
+  std::cerr << "Paths:" << std::endl;
+  std::cerr << "  -l, --path-lengths    Path length distribution (in bp)" << std::endl;
+  std::cerr << "  -s, --sample-steps    Path and step counts for each sample" << std::endl;
+  std::cerr << std::endl;
+  std::cerr << "Other options:" << std::endl;
+  std::cerr << "  -j, --json            Output the statistics as a JSON object" << std::endl;
+  std::cerr << "  -t, --threads N       Use N parallel threads" << std::endl;
   std::cerr << std::endl;
 
   std::exit(exit_code);
@@ -143,10 +250,16 @@ Config::Config(int argc, char** argv)
     { "node-visits", no_argument, 0, 'v' },
     { "record-bytes", no_argument, 0, 'b' },
     { "record-runs", no_argument, 0, 'r' },
+    { "region-bytes", required_argument, 0, 'R' },
+    { "path-lengths", no_argument, 0, 'l' },
+    { "sample-steps", no_argument, 0, 's' },
+    { "json", no_argument, 0, 'j' },
+    { "threads", required_argument, 0, 't' },
+    { 0, 0, 0, 0 }
   };
 
   // Process options.
-  while((c = getopt_long(argc, argv, "gidvbr", long_options, &option_index)) != -1)
+  while((c = getopt_long(argc, argv, "gidvbrR:lsjt:", long_options, &option_index)) != -1)
   {
     switch(c)
     {
@@ -170,6 +283,43 @@ Config::Config(int argc, char** argv)
     case 'r':
       this->record_runs = true;
       break;
+    case 'R':
+      try { this->region_size = std::stoul(optarg); }
+      catch(const std::logic_error&)
+      {
+        std::cerr << "gbz_stats: Invalid region size: " << optarg << std::endl;
+        std::exit(EXIT_FAILURE);
+      }
+      if(this->region_size == 0)
+      {
+        std::cerr << "gbz_stats: Region size must be positive" << std::endl;
+        std::exit(EXIT_FAILURE);
+      }
+      break;
+
+    case 'l':
+      this->path_lengths = true;
+      break;
+    case 's':
+      this->sample_steps = true;
+      break;
+
+    case 'j':
+      this->json = true;
+      break;
+    case 't':
+      {
+        int threads = 0;
+        try { threads = std::stoi(optarg); }
+        catch(const std::logic_error&) { threads = 0; }
+        if(threads <= 0)
+        {
+          std::cerr << "gbz_stats: Invalid number of threads: " << optarg << std::endl;
+          std::exit(EXIT_FAILURE);
+        }
+        omp_set_num_threads(threads);
+      }
+      break;
 
     case '?':
       std::exit(EXIT_FAILURE);
@@ -186,12 +336,275 @@ Config::Config(int argc, char** argv)
 //------------------------------------------------------------------------------
 
 void
-print_distribution(const std::map<size_t, size_t>& distribution, const std::string& header1, const std::string& header2)
+Statistics::merge(const Statistics& another)
 {
-  std::cout << header1 << "\t" << header2 << std::endl;
-  for(auto iter = distribution.begin(); iter != distribution.end(); ++iter)
+  auto merge_distribution = [](std::map<size_t, size_t>& to, const std::map<size_t, size_t>& from)
+  {
+    for(auto iter = from.begin(); iter != from.end(); ++iter) { to[iter->first] += iter->second; }
+  };
+  merge_distribution(this->node_degrees, another.node_degrees);
+  merge_distribution(this->node_visits, another.node_visits);
+  merge_distribution(this->record_bytes, another.record_bytes);
+  merge_distribution(this->record_runs, another.record_runs);
+  merge_distribution(this->path_lengths, another.path_lengths);
+
+  auto merge_counts = [](std::vector<size_t>& to, const std::vector<size_t>& from)
   {
-    std::cout << iter->first << "\t" << iter->second << std::endl;
+    if(to.size() < from.size()) { to.resize(from.size(), 0); }
+    for(size_t i = 0; i < from.size(); i++) { to[i] += from[i]; }
+  };
+  merge_counts(this->region_bytes, another.region_bytes);
+  merge_counts(this->region_records, another.region_records);
+  merge_counts(this->sample_paths, another.sample_paths);
+  merge_counts(this->sample_steps, another.sample_steps);
+}
+
+//------------------------------------------------------------------------------
+
+void
+node_pass(const GBZ& gbz, const Config& config, Statistics& statistics)
+{
+  const GBWTGraph& graph = gbz.graph;
+  const gbwt::GBWT& index = gbz.index;
+
+  gbwt::node_type first_node = index.firstNode();
+  size_t forward_nodes = (index.sigma() - first_node) / 2;
+  size_t regions = (config.region_size > 0 ? (forward_nodes + config.region_size - 1) / config.region_size : 0);
+
+  std::vector<Statistics> thread_statistics(omp_get_max_threads());
+  for(Statistics& partial : thread_statistics)
+  {
+    partial.region_bytes = std::vector<size_t>(regions, 0);
+    partial.region_records = std::vector<size_t>(regions, 0);
+  }
+
+  bool bytes = (config.record_bytes || config.region_size > 0);
+
+  #pragma omp parallel for schedule(dynamic, NODE_BLOCK_SIZE)
+  for(size_t i = 0; i < forward_nodes; i++)
+  {
+    Statistics& partial = thread_statistics[omp_get_thread_num()];
+    gbwt::node_type forward = first_node + 2 * i;
+    nid_t id = gbwt::Node::id(forward);
+
+    if(config.node_degrees && graph.has_node(id))
+    {
+      handle_t handle = GBWTGraph::node_to_handle(forward);
+      size_t degree = graph.get_degree(handle, false) + graph.get_degree(handle, true);
+      partial.node_degrees[degree]++;
+    }
+
+    if(config.node_visits) { partial.node_visits[index.nodeSize(forward)]++; }
+
+    for(gbwt::node_type node : { forward, forward + 1 })
+    {
+      if(bytes)
+      {
+        std::pair<gbwt::size_type, gbwt::size_type> range = index.bwt.getRange(index.toComp(node));
+        size_t record_bytes = range.second - range.first;
+        if(config.record_bytes) { partial.record_bytes[record_bytes]++; }
+        if(config.region_size > 0)
+        {
+          size_t region = i / config.region_size;
+          partial.region_bytes[region] += record_bytes;
+          partial.region_records[region]++;
+        }
+      }
+      if(config.record_runs) { partial.record_runs[index.record(node).runs().first]++; }
+    }
+  }
+
+  for(const Statistics& partial : thread_statistics) { statistics.merge(partial); }
+}
+
+void
+path_pass(const GBZ& gbz, const Config& config, Statistics& statistics)
+{
+  const GBWTGraph& graph = gbz.graph;
+  const gbwt::GBWT& index = gbz.index;
+
+  bool path_names = (index.hasMetadata() && index.metadata.hasPathNames());
+  if(config.sample_steps && !path_names)
+  {
+    std::cerr << "gbz_stats: No path names; cannot determine per-sample step counts" << std::endl;
+  }
+  bool samples = (config.sample_steps && path_names);
+  size_t paths = (index.bidirectional() ? index.sequences() / 2 : index.sequences());
+  size_t sample_count = (samples ? index.metadata.samples() : 0);
+
+  std::vector<Statistics> thread_statistics(omp_get_max_threads());
+  for(Statistics& partial : thread_statistics)
+  {
+    partial.sample_paths = std::vector<size_t>(sample_count, 0);
+    partial.sample_steps = std::vector<size_t>(sample_count, 0);
+  }
+
+  #pragma omp parallel for schedule(dynamic, 1)
+  for(size_t path_id = 0; path_id < paths; path_id++)
+  {
+    Statistics& partial = thread_statistics[omp_get_thread_num()];
+    gbwt::size_type sequence = (index.bidirectional() ? gbwt::Path::encode(path_id, false) : path_id);
+    gbwt::vector_type path = index.extract(sequence);
+
+    if(config.path_lengths)
+    {
+      size_t length = 0;
+      for(gbwt::node_type node : path) { length += graph.get_length(GBWTGraph::node_to_handle(node)); }
+      partial.path_lengths[length]++;
+    }
+
+    if(samples)
+    {
+      gbwt::size_type sample = index.metadata.path(path_id).sample;
+      partial.sample_paths[sample]++;
+      partial.sample_steps[sample] += path.size();
+    }
+  }
+
+  for(const Statistics& partial : thread_statistics) { statistics.merge(partial); }
+}
+
+//------------------------------------------------------------------------------
+
+std::string
+json_string(const std::string& str)
+{
+  std::string result = "\"";
+  for(char c : str)
+  {
+    switch(c)
+    {
+    case '"':
+      result += "\\\""; break;
+    case '\\':
+      result += "\\\\"; break;
+    case '\n':
+      result += "\\n"; break;
+    case '\t':
+      result += "\\t"; break;
+    default:
+      if(static_cast<unsigned char>(c) < 0x20)
+      {
+        char buffer[8];
+        std::snprintf(buffer, sizeof(buffer), "\\u%04x", static_cast<unsigned>(c));
+        result += buffer;
+      }
+      else { result += c; }
+    }
+  }
+  result += "\"";
+  return result;
+}
+
+Report::Report(bool json) :
+  json(json), fields(0)
+{
+  if(this->json) { std::cout << "{"; }
+}
+
+Report::~Report()
+{
+  if(this->json) { std::cout << std::endl << "}" << std::endl; }
+}
+
+void
+Report::field(const std::string& key)
+{
+  if(this->fields > 0) { std::cout << ","; }
+  std::cout << std::endl << "  " << json_string(key) << ": ";
+  this->fields++;
+}
+
+void
+Report::value(const std::string& key, const std::string& header, size_t value)
+{
+  if(this->json)
+  {
+    this->field(key);
+    std::cout << value;
+  }
+  else
+  {
+    std::cout << header << "\t" << value << std::endl;
+  }
+}
+
+void
+Report::flag(const std::string& key, const std::string& header, bool value)
+{
+  if(this->json)
+  {
+    this->field(key);
+    std::cout << (value ? "true" : "false");
+  }
+  else
+  {
+    std::cout << header << "\t" << (value ? "true" : "false") << std::endl;
+  }
+}
+
+void
+Report::distribution(const std::string& key, const std::map<size_t, size_t>& distribution, const std::string& header1, const std::string& header2)
+{
+  if(this->json)
+  {
+    this->field(key);
+    std::cout << "[";
+    for(auto iter = distribution.begin(); iter != distribution.end(); ++iter)
+    {
+      if(iter != distribution.begin()) { std::cout << ", "; }
+      std::cout << "[" << iter->first << ", " << iter->second << "]";
+    }
+    std::cout << "]";
+  }
+  else
+  {
+    std::cout << header1 << "\t" << header2 << std::endl;
+    for(auto iter = distribution.begin(); iter != distribution.end(); ++iter)
+    {
+      std::cout << iter->first << "\t" << iter->second << std::endl;
+    }
+  }
+}
+
+void
+Report::table(const std::string& key, const std::vector<std::string>& headers, const std::vector<std::vector<std::string>>& rows, size_t text_columns)
+{
+  if(this->json)
+  {
+    // The first `text_columns` columns are strings and the rest are numbers.
+    this->field(key);
+    std::cout << "[";
+    for(size_t row = 0; row < rows.size(); row++)
+    {
+      if(row > 0) { std::cout << ","; }
+      std::cout << std::endl << "    { ";
+      for(size_t col = 0; col < headers.size(); col++)
+      {
+        if(col > 0) { std::cout << ", "; }
+        std::cout << json_string(headers[col]) << ": ";
+        std::cout << (col < text_columns ? json_string(rows[row][col]) : rows[row][col]);
+      }
+      std::cout << " }";
+    }
+    if(!(rows.empty())) { std::cout << std::endl << "  "; }
+    std::cout << "]";
+  }
+  else
+  {
+    for(size_t col = 0; col < headers.size(); col++)
+    {
+      std::cout << (col > 0 ? "\t" : "") << headers[col];
+    }
+    std::cout << std::endl;
+    for(const std::vector<std::string>& row : rows)
+    {
+      for(size_t col = 0; col < row.size(); col++)
+      {
+        std::cout << (col > 0 ? "\t" : "") << row[col];
+      }
+      std::cout << std::endl;
+    }
   }
 }
 
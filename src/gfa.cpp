@@ -5,6 +5,7 @@
 #include <algorithm>
 #include <functional>
 #include <limits>
+#include <queue>
 #include <string>
 #include <utility>
 
@@ -21,6 +22,7 @@ namespace gbwtgraph
 // Global variables.
 
 const std::string GFA_EXTENSION = ".gfa";
+const std::string FASTA_EXTENSION = ".fa";
 
 // Class constants.
 
@@ -33,6 +35,7 @@ const std::string GFAParsingParameters::PAN_SN_FIELDS = "XSHC";
 const PathSense GFAParsingParameters::PAN_SN_SENSE = PathSense::HAPLOTYPE;
 
 constexpr size_t GFAExtractionParameters::LARGE_RECORD_BYTES;
+constexpr size_t FASTAExtractionParameters::LINE_LENGTH;
 
 //------------------------------------------------------------------------------
 
@@ -911,6 +914,10 @@ parse_segments(const GFAFile& gfa_file, const GFAParsingParameters& parameters)
       std::cerr << "Translating segment ids into valid node ids" << std::endl;
     }
   }
+  else if(parameters.renumber_nodes)
+  {
+    translate = true; // Renumbering needs the translation.
+  }
 
   std::pair<std::unique_ptr<SequenceSource>, std::unique_ptr<EmptyGraph>> result(new SequenceSource(), new EmptyGraph());
   gfa_file.for_each_segment([&](const std::string& name, view_type sequence)
@@ -991,6 +998,112 @@ parse_links(const GFAFile& gfa_file, const SequenceSource& source, EmptyGraph& g
 }
 
 
+//------------------------------------------------------------------------------
+
+// Returns the node ids in the component in a topological order of the forward
+// orientations, or in breadth-first order from the first node if the component
+// is cyclic.
+std::vector<nid_t>
+locality_order(const HandleGraph& graph, const std::vector<nid_t>& component)
+{
+  std::vector<nid_t> result;
+  result.reserve(component.size());
+
+  std::unordered_set<nid_t> subgraph(component.begin(), component.end());
+  std::vector<handle_t> order = topological_order(graph, subgraph);
+  if(!(order.empty()))
+  {
+    for(handle_t handle : order)
+    {
+      if(!(graph.get_is_reverse(handle))) { result.push_back(graph.get_id(handle)); }
+    }
+    return result;
+  }
+
+  std::unordered_set<nid_t> found { component.front() };
+  std::queue<nid_t> active;
+  active.push(component.front());
+  while(!(active.empty()))
+  {
+    nid_t curr = active.front(); active.pop();
+    result.push_back(curr);
+    for(bool go_left : { false, true })
+    {
+      graph.follow_edges(graph.get_handle(curr, false), go_left, [&](const handle_t& next) -> bool
+      {
+        nid_t next_id = graph.get_id(next);
+        if(found.insert(next_id).second) { active.push(next_id); }
+        return true;
+      });
+    }
+  }
+  return result;
+}
+
+// Replaces the source and the graph with versions where the segments are renumbered
+// in locality order. Assumes that the source uses segment translation.
+void
+renumber_segments(const GFAFile& gfa_file, std::unique_ptr<SequenceSource>& source, std::unique_ptr<EmptyGraph>& graph, const GFAParsingParameters& parameters)
+{
+  double start = gbwt::readTimer();
+  if(parameters.show_progress)
+  {
+    std::cerr << "Renumbering nodes" << std::endl;
+  }
+
+  // Determine the order of the nodes within each component.
+  std::vector<std::vector<nid_t>> components = weakly_connected_components(*graph);
+  std::vector<std::vector<nid_t>> orders(components.size());
+  #pragma omp parallel for schedule(dynamic, 1)
+  for(size_t i = 0; i < components.size(); i++)
+  {
+    orders[i] = locality_order(*graph, components[i]);
+  }
+  std::unordered_map<nid_t, size_t> node_rank;
+  node_rank.reserve(graph->get_node_count());
+  for(const std::vector<nid_t>& order : orders)
+  {
+    for(nid_t id : order) { node_rank.insert({ id, node_rank.size() }); }
+  }
+  components.clear(); orders.clear();
+
+  // Order the segments by the rank of their first node.
+  std::vector<std::pair<size_t, const std::string*>> segments;
+  segments.reserve(source->segment_translation.size());
+  for(auto iter = source->segment_translation.begin(); iter != source->segment_translation.end(); ++iter)
+  {
+    segments.emplace_back(node_rank[iter->second.first], &(iter->first));
+  }
+  std::sort(segments.begin(), segments.end());
+  node_rank.clear();
+
+  // Translate the segments again in the new order. The nodes of a segment are
+  // stored consecutively, so we can use a view over all of them.
+  size_t max_node_length = (parameters.max_node_length == 0 ? std::numeric_limits<size_t>::max() : parameters.max_node_length);
+  std::unique_ptr<SequenceSource> new_source(new SequenceSource());
+  std::unique_ptr<EmptyGraph> new_graph(new EmptyGraph());
+  for(auto& segment : segments)
+  {
+    std::pair<nid_t, nid_t> old_nodes = source->get_translation(*(segment.second));
+    view_type sequence = source->get_sequence_view(old_nodes.first);
+    for(nid_t id = old_nodes.first + 1; id < old_nodes.second; id++) { sequence.second += source->get_length(id); }
+    std::pair<nid_t, nid_t> new_nodes = new_source->translate_segment(*(segment.second), sequence, max_node_length);
+    for(nid_t id = new_nodes.first; id < new_nodes.second; id++) { new_graph->create_node(id); }
+  }
+  source = std::move(new_source);
+  graph = std::move(new_graph);
+
+  if(parameters.show_progress)
+  {
+    double seconds = gbwt::readTimer() - start;
+    std::cerr << "Renumbered " << source->get_node_count() << " nodes in " << seconds << " seconds" << std::endl;
+  }
+
+  // The edges must be parsed again with the new node ids.
+  parse_links(gfa_file, *source, *graph, parameters);
+}
+
+
 std::unordered_map<std::string, std::string>
 parse_header_tags(const GFAFile& gfa_file, const GFAParsingParameters& parameters)
 {
@@ -1065,8 +1178,175 @@ parse_metadata(const GFAFile& gfa_file, const std::vector<ConstructionJob>& jobs
   return result;
 }
 
+// Returns a bitvector marking the node identifiers that correspond to entire segments.
+// Without a segment translation, every node is a segment.
+sdsl::bit_vector
+whole_segment_nodes(const SequenceSource& source)
+{
+  nid_t limit = 0;
+  for(auto iter = source.nodes.begin(); iter != source.nodes.end(); ++iter) { limit = std::max(limit, iter->first + 1); }
+  sdsl::bit_vector result(limit, 0);
+  for(auto iter = source.nodes.begin(); iter != source.nodes.end(); ++iter) { result[iter->first] = 1; }
+  return result;
+}
+
+/*
+  Finds the maximal non-branching chains in the index and splits them into pieces
+  of at most max_length bp. A node can be extended to the right if it has a single
+  successor, the successor has a single predecessor, and no path ends at the node or
+  starts at the successor. Returns pieces of at least two oriented nodes. The first
+  node in each piece is in forward orientation if possible.
+*/
+std::vector<gbwt::vector_type>
+find_chains(const gbwt::GBWT& index, const SequenceSource& source, const sdsl::bit_vector& whole_segments, size_t max_length)
+{
+  std::vector<gbwt::vector_type> result;
+  if(index.empty()) { return result; }
+
+  gbwt::CachedGBWT cache(index, true);
+  auto is_whole = [&](gbwt::node_type node) -> bool
+  {
+    size_t id = gbwt::Node::id(node);
+    return (id < whole_segments.size() && whole_segments[id]);
+  };
+  // Returns the node to the right of `from` in the chain, or ENDMARKER if there is none.
+  auto extend_right = [&](gbwt::node_type from) -> gbwt::node_type
+  {
+    if(!is_whole(from)) { return gbwt::ENDMARKER; }
+    gbwt::size_type cache_index = cache.findRecord(from);
+    if(cache.outdegree(cache_index) != 1) { return gbwt::ENDMARKER; }
+    gbwt::node_type to = cache.successor(cache_index, 0);
+    if(to == gbwt::ENDMARKER || gbwt::Node::id(to) == gbwt::Node::id(from) || !is_whole(to)) { return gbwt::ENDMARKER; }
+    cache_index = cache.findRecord(gbwt::Node::reverse(to));
+    if(cache.outdegree(cache_index) != 1 || cache.successor(cache_index, 0) != gbwt::Node::reverse(from)) { return gbwt::ENDMARKER; }
+    return to;
+  };
+
+  for(gbwt::node_type node = index.firstNode(); node < index.sigma(); node += 2)
+  {
+    if(index.empty(node)) { continue; }
+
+    // Start from the end of a chain and make the chain go to the right.
+    gbwt::node_type left = extend_right(gbwt::Node::reverse(node));
+    gbwt::node_type right = extend_right(node);
+    if((left == gbwt::ENDMARKER) == (right == gbwt::ENDMARKER)) { continue; } // Interior node or no chain.
+    gbwt::node_type start = (left == gbwt::ENDMARKER ? node : gbwt::Node::reverse(node));
+    gbwt::vector_type chain { static_cast<gbwt::vector_type::value_type>(start) };
+    std::unordered_set<gbwt::node_type> visited { gbwt::Node::id(start) };
+    for(gbwt::node_type next = extend_right(start); next != gbwt::ENDMARKER; next = extend_right(next))
+    {
+      if(!(visited.insert(gbwt::Node::id(next)).second)) { break; }
+      chain.push_back(next);
+    }
+
+    // We find each chain from both ends.
+    if(gbwt::Node::id(chain.back()) < gbwt::Node::id(chain.front())) { continue; }
+
+    // Split the chain into pieces.
+    size_t i = 0;
+    while(i < chain.size())
+    {
+      size_t j = i, length = 0;
+      while(j < chain.size())
+      {
+        size_t node_length = source.get_length(gbwt::Node::id(chain[j]));
+        if(j > i && length + node_length > max_length) { break; }
+        length += node_length; j++;
+      }
+      if(j - i >= 2)
+      {
+        gbwt::vector_type piece(chain.begin() + i, chain.begin() + j);
+        if(gbwt::Node::is_reverse(piece.front()) && gbwt::Node::is_reverse(piece.back()))
+        {
+          gbwt::reversePath(piece);
+        }
+        result.push_back(piece);
+      }
+      i = j;
+    }
+  }
+
+  return result;
+}
+
+/*
+  Rebuilds the index with each chain replaced by a node with the identifier of the
+  first node in the chain. The forward orientation of the new node corresponds to
+  the chain.
+*/
+gbwt::GBWT
+merge_chains(const gbwt::GBWT& index, const std::vector<gbwt::vector_type>& chains, const GFAParsingParameters& parameters, gbwt::size_type node_width, gbwt::size_type batch_size)
+{
+  // Map each oriented node in the chains to the replacement, or to ENDMARKER if the
+  // node should be removed.
+  std::unordered_map<gbwt::node_type, gbwt::node_type> replacement;
+  for(const gbwt::vector_type& chain : chains)
+  {
+    for(gbwt::node_type node : chain)
+    {
+      replacement[node] = gbwt::ENDMARKER;
+      replacement[gbwt::Node::reverse(node)] = gbwt::ENDMARKER;
+    }
+    nid_t id = gbwt::Node::id(chain.front());
+    replacement[chain.front()] = gbwt::Node::encode(id, false);
+    replacement[gbwt::Node::reverse(chain.back())] = gbwt::Node::encode(id, true);
+  }
+
+  gbwt::GBWTBuilder builder(node_width, batch_size, parameters.sample_interval);
+  gbwt::vector_type merged;
+  for(gbwt::size_type sequence = 0; sequence < index.sequences(); sequence += 2)
+  {
+    merged.clear();
+    for(gbwt::node_type node : index.extract(sequence))
+    {
+      auto iter = replacement.find(node);
+      if(iter == replacement.end()) { merged.push_back(node); }
+      else if(iter->second != gbwt::ENDMARKER) { merged.push_back(iter->second); }
+    }
+    builder.insert(merged, true);
+  }
+  builder.finish();
+  gbwt::GBWT result(builder.index);
+  builder.index = gbwt::DynamicGBWT();
+
+  return result;
+}
+
+// Replaces the first node in each chain with the merged sequence and removes the
+// other nodes. The segment translation of the removed nodes remains, but the
+// segments are no longer present in the graph.
+void
+merge_chain_sequences(SequenceSource& source, const std::vector<std::vector<gbwt::vector_type>>& chains, const GFAParsingParameters& parameters)
+{
+  double start = gbwt::readTimer();
+  size_t merged_nodes = 0, removed_nodes = 0;
+  for(const std::vector<gbwt::vector_type>& job_chains : chains)
+  {
+    for(const gbwt::vector_type& chain : job_chains)
+    {
+      std::string sequence;
+      for(gbwt::node_type node : chain)
+      {
+        std::string part = source.get_sequence(gbwt::Node::id(node));
+        if(gbwt::Node::is_reverse(node)) { reverse_complement_in_place(part); }
+        sequence += part;
+      }
+      for(gbwt::node_type node : chain) { source.nodes.erase(gbwt::Node::id(node)); }
+      source.add_node(gbwt::Node::id(chain.front()), sequence);
+      merged_nodes++; removed_nodes += chain.size() - 1;
+    }
+  }
+
+  if(parameters.show_progress)
+  {
+    double seconds = gbwt::readTimer() - start;
+    std::cerr << "Merged " << (merged_nodes + removed_nodes) << " nodes into " << merged_nodes << " nodes in " << seconds << " seconds" << std::endl;
+  }
+}
+
 std::unique_ptr<gbwt::GBWT>
-parse_paths(const GFAFile& gfa_file, const std::vector<ConstructionJob>& jobs, const SequenceSource& source, const GFAParsingParameters& parameters, gbwt::size_type node_width, gbwt::size_type batch_size)
+parse_paths(const GFAFile& gfa_file, const std::vector<ConstructionJob>& jobs, const SequenceSource& source, const GFAParsingParameters& parameters, gbwt::size_type node_width, gbwt::size_type batch_size,
+            std::vector<std::vector<gbwt::vector_type>>& chains)
 {
   double start = gbwt::readTimer();
   if(parameters.show_progress)
@@ -1080,6 +1360,10 @@ parse_paths(const GFAFile& gfa_file, const std::vector<ConstructionJob>& jobs, c
   omp_set_num_threads(parallel_jobs);
   std::vector<gbwt::GBWT> partial_indexes(jobs.size());
   std::vector<gbwt::vector_type> current_paths(parallel_jobs);
+  chains = std::vector<std::vector<gbwt::vector_type>>(jobs.size());
+  sdsl::bit_vector whole_segments;
+  if(parameters.unchop_chains) { whole_segments = whole_segment_nodes(source); }
+  size_t max_node_length = (parameters.max_node_length == 0 ? std::numeric_limits<size_t>::max() : parameters.max_node_length);
 
   auto add_segment = [&](const std::string& name, bool is_reverse)
   {
@@ -1142,6 +1426,16 @@ parse_paths(const GFAFile& gfa_file, const std::vector<ConstructionJob>& jobs, c
     partial_indexes[jobs[i].id] = gbwt::GBWT(builder.index);
     // Deleting a dynamic GBWT is a bit expensive, so we do it manually to include it in the measured time.
     builder.index = gbwt::DynamicGBWT();
+    // The paths in a job only visit the nodes of its components, so we can merge
+    // the chains in the partial index.
+    if(parameters.unchop_chains)
+    {
+      chains[jobs[i].id] = find_chains(partial_indexes[jobs[i].id], source, whole_segments, max_node_length);
+      if(!(chains[jobs[i].id].empty()))
+      {
+        partial_indexes[jobs[i].id] = merge_chains(partial_indexes[jobs[i].id], chains[jobs[i].id], parameters, node_width, batch_size);
+      }
+    }
     if(parameters.show_progress)
     {
       double seconds = gbwt::readTimer() - job_start;
@@ -1253,15 +1547,22 @@ gfa_to_gbwt(const std::string& gfa_filename, const GFAParsingParameters& paramet
   std::unique_ptr<SequenceSource> source;
   std::unique_ptr<EmptyGraph> graph;
   std::tie(source, graph) = parse_segments(gfa_file, parameters);
-  gbwt::size_type node_width = sdsl::bits::length(gbwt::Node::encode(graph->max_node_id(), true));
+  if(parameters.unchop_chains && source->uses_translation())
+  {
+    throw std::runtime_error("Cannot unchop chains in a graph with segment translation");
+  }
 
-  // Parse links and create jobs.
+  // Parse links, renumber the nodes if necessary, and create jobs.
   parse_links(gfa_file, *source, *graph, parameters);
+  if(parameters.renumber_nodes) { renumber_segments(gfa_file, source, graph, parameters); }
+  gbwt::size_type node_width = sdsl::bits::length(gbwt::Node::encode(graph->max_node_id(), true));
   std::vector<ConstructionJob> jobs = determine_jobs(gfa_file, *source, graph, parameters);
 
   // Build the GBWT index.
   gbwt::Metadata final_metadata = parse_metadata(gfa_file, jobs, metadata, parameters);
-  std::unique_ptr<gbwt::GBWT> gbwt_index = parse_paths(gfa_file, jobs, *source, parameters, node_width, batch_size);
+  std::vector<std::vector<gbwt::vector_type>> chains;
+  std::unique_ptr<gbwt::GBWT> gbwt_index = parse_paths(gfa_file, jobs, *source, parameters, node_width, batch_size, chains);
+  if(parameters.unchop_chains) { merge_chain_sequences(*source, chains, parameters); }
   gbwt_index->addMetadata();
   gbwt_index->metadata = final_metadata;
   
@@ -1802,4 +2103,472 @@ gbwt_to_gfa(const GBWTGraph& graph, std::ostream& out, const GFAExtractionParame
 
 //------------------------------------------------------------------------------
 
+// Returns the ids of the paths selected for FASTA extraction in increasing order.
+std::vector<gbwt::size_type>
+select_fasta_paths(const gbwt::GBWT& index, const FASTAExtractionParameters& parameters)
+{
+  std::vector<gbwt::size_type> result;
+  bool selection = !(parameters.samples.empty() && parameters.contigs.empty());
+  if(!(index.hasMetadata() && index.metadata.hasPathNames()))
+  {
+    if(selection)
+    {
+      throw std::runtime_error("gbwt_to_fasta(): Sample / contig selection requires path names");
+    }
+    for(gbwt::size_type path_id = 0; path_id < index.sequences() / 2; path_id++) { result.push_back(path_id); }
+    return result;
+  }
+
+  const gbwt::Metadata& metadata = index.metadata;
+  auto is_selected = [](const std::unordered_set<std::string>& selected, bool has_names, size_t count, const std::function<std::string(size_t)>& get_name)
+  {
+    std::vector<bool> result(count, selected.empty());
+    if(selected.empty()) { return result; }
+    for(size_t i = 0; i < count; i++)
+    {
+      std::string name = (has_names ? get_name(i) : std::to_string(i));
+      result[i] = (selected.find(name) != selected.end());
+    }
+    return result;
+  };
+  std::vector<bool> samples = is_selected(parameters.samples, metadata.hasSampleNames(), metadata.samples(), [&](size_t i) -> std::string
+  {
+    return metadata.sample(i);
+  });
+  std::vector<bool> contigs = is_selected(parameters.contigs, metadata.hasContigNames(), metadata.contigs(), [&](size_t i) -> std::string
+  {
+    return metadata.contig(i);
+  });
+
+  for(gbwt::size_type path_id = 0; path_id < metadata.paths(); path_id++)
+  {
+    const gbwt::PathName& path_name = metadata.path(path_id);
+    bool sample_ok = (path_name.sample < samples.size() ? samples[path_name.sample] : parameters.samples.empty());
+    bool contig_ok = (path_name.contig < contigs.size() ? contigs[path_name.contig] : parameters.contigs.empty());
+    if(sample_ok && contig_ok) { result.push_back(path_id); }
+  }
+  return result;
+}
+
+// Appends a FASTA record for the path to the writer.
+void
+write_fasta_record(const GBWTGraph& graph, const LargeRecordCache& record_cache, ManualTSVWriter& writer, gbwt::size_type path_id, bool path_names, size_t line_length)
+{
+  writer.put('>');
+  if(path_names)
+  {
+    PathSense sense = get_path_sense(*(graph.index), path_id, graph.reference_samples);
+    writer.write(compose_path_name(*(graph.index), path_id, sense));
+  }
+  else { writer.write(path_id); }
+  writer.newline();
+
+  gbwt::vector_type path = record_cache.extract(gbwt::Path::encode(path_id, false));
+  size_t column = 0;
+  for(gbwt::node_type node : path)
+  {
+    view_type view = graph.get_sequence_view(GBWTGraph::node_to_handle(node));
+    if(line_length == 0)
+    {
+      writer.write(view); column += view.second;
+      continue;
+    }
+    while(view.second > 0)
+    {
+      size_t length = std::min(view.second, line_length - column);
+      writer.write(view_type(view.first, length));
+      view.first += length; view.second -= length;
+      column += length;
+      if(column == line_length) { writer.newline(); column = 0; }
+    }
+  }
+  if(column > 0) { writer.newline(); }
+}
+
+void
+gbwt_to_fasta(const GBWTGraph& graph, std::ostream& out, const FASTAExtractionParameters& parameters)
+{
+  const gbwt::GBWT& index = *(graph.index);
+  bool path_names = (index.hasMetadata() && index.metadata.hasPathNames());
+  std::vector<gbwt::size_type> selected = select_fasta_paths(index, parameters);
+
+  // Cache large GBWT records.
+  double start = gbwt::readTimer();
+  if(parameters.show_progress)
+  {
+    std::cerr << "Caching large GBWT records" << std::endl;
+  }
+  LargeRecordCache record_cache(index, parameters.large_record_bytes);
+  if(parameters.show_progress)
+  {
+    double seconds = gbwt::readTimer() - start;
+    std::cerr << "Cached " << record_cache.size() << " GBWT records larger than " << parameters.large_record_bytes << " bytes in " << seconds << " seconds" << std::endl;
+  }
+
+  start = gbwt::readTimer();
+  if(parameters.show_progress)
+  {
+    std::cerr << "Writing " << selected.size() << " paths" << std::endl;
+  }
+  size_t threads = parameters.threads();
+  omp_set_num_threads(threads);
+  std::vector<ManualTSVWriter> writers(threads, ManualTSVWriter(out));
+
+  if(parameters.ordered)
+  {
+    for(size_t batch = 0; batch < selected.size(); batch += threads)
+    {
+      size_t batch_size = std::min(threads, selected.size() - batch);
+      #pragma omp parallel for schedule(dynamic, 1)
+      for(size_t i = 0; i < batch_size; i++)
+      {
+        write_fasta_record(graph, record_cache, writers[i], selected[batch + i], path_names, parameters.line_length);
+      }
+      for(size_t i = 0; i < batch_size; i++) { writers[i].flush(); }
+    }
+  }
+  else
+  {
+    #pragma omp parallel for schedule(dynamic, 1)
+    for(size_t i = 0; i < selected.size(); i++)
+    {
+      // The buffer only contains complete records at this point.
+      ManualTSVWriter& writer = writers[omp_get_thread_num()];
+      write_fasta_record(graph, record_cache, writer, selected[i], path_names, parameters.line_length);
+      if(writer.full())
+      {
+        #pragma omp critical
+        {
+          writer.flush();
+        }
+      }
+    }
+    for(ManualTSVWriter& writer : writers) { writer.flush(); }
+  }
+
+  if(parameters.show_progress)
+  {
+    double seconds = gbwt::readTimer() - start;
+    std::cerr << "Wrote " << selected.size() << " paths in " << seconds << " seconds" << std::endl;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+void
+write_translation(const GBWTGraph& graph, std::ostream& out, const GFAExtractionParameters& parameters)
+{
+  if(!(graph.has_segment_names())) { return; }
+
+  double start = gbwt::readTimer();
+  if(parameters.show_progress)
+  {
+    std::cerr << "Writing the translation table" << std::endl;
+  }
+
+  size_t threads = parameters.threads();
+  omp_set_num_threads(threads);
+  size_t segments = graph.segments.size();
+  size_t chunks = (segments + TRANSLATION_CHUNK_SIZE - 1) / TRANSLATION_CHUNK_SIZE;
+  sdsl::sd_vector<>::select_1_type select(&(graph.node_to_segment));
+  std::vector<ManualTSVWriter> writers(threads, ManualTSVWriter(out));
+  size_t total_segments = 0;
+
+  // Format a batch of chunks in parallel with one writer per chunk, and then
+  // write the chunks in order.
+  for(size_t batch = 0; batch < chunks; batch += threads)
+  {
+    size_t batch_size = std::min(threads, chunks - batch);
+    #pragma omp parallel for schedule(dynamic, 1) reduction(+:total_segments)
+    for(size_t i = 0; i < batch_size; i++)
+    {
+      ManualTSVWriter& writer = writers[i];
+      size_t rank = (batch + i) * TRANSLATION_CHUNK_SIZE;
+      size_t rank_limit = std::min(rank + TRANSLATION_CHUNK_SIZE, segments);
+      auto iter = graph.node_to_segment.predecessor(select(rank + 1));
+      for(; rank < rank_limit; rank++)
+      {
+        nid_t first = iter->second;
+        view_type name = graph.segments.view(iter->first);
+        ++iter;
+        nid_t limit = iter->second;
+        // The translation may include segments that were not used on any path.
+        if(!(graph.has_node(first))) { continue; }
+        writer.put('T'); writer.newfield();
+        writer.write(name); writer.newfield();
+        writer.write(first);
+        for(nid_t id = first + 1; id < limit; id++)
+        {
+          writer.put(','); writer.write(id);
+        }
+        writer.newline();
+        total_segments++;
+      }
+    }
+    for(size_t i = 0; i < batch_size; i++) { writers[i].flush(); }
+  }
+
+  if(parameters.show_progress)
+  {
+    double seconds = gbwt::readTimer() - start;
+    std::cerr << "Wrote " << total_segments << " segments in " << seconds << " seconds" << std::endl;
+  }
+}
+
+//------------------------------------------------------------------------------
+
+/*
+  A read-only memory-mapped translation table. Throws `std::runtime_error` on
+  failure.
+*/
+struct TranslationFile
+{
+  explicit TranslationFile(const std::string& filename);
+  ~TranslationFile();
+
+  TranslationFile(const TranslationFile&) = delete;
+  TranslationFile& operator=(const TranslationFile&) = delete;
+
+  const char* begin() const { return this->ptr; }
+  const char* end() const { return this->ptr + this->file_size; }
+
+  int    fd;
+  size_t file_size;
+  char*  ptr;
+};
+
+TranslationFile::TranslationFile(const std::string& filename) :
+  fd(-1), file_size(0), ptr(nullptr)
+{
+  this->fd = ::open(filename.c_str(), O_RDONLY);
+  if(this->fd < 0)
+  {
+    throw std::runtime_error("TranslationFile: Cannot open file " + filename);
+  }
+
+  struct stat st;
+  if(::fstat(this->fd, &st) < 0)
+  {
+    ::close(this->fd);
+    throw std::runtime_error("TranslationFile: Cannot stat file " + filename);
+  }
+  this->file_size = st.st_size;
+  if(this->file_size == 0) { return; }
+
+  void* temp_ptr = ::mmap(nullptr, this->file_size, PROT_READ, MAP_FILE | MAP_SHARED, this->fd, 0);
+  if(temp_ptr == MAP_FAILED)
+  {
+    ::close(this->fd);
+    throw std::runtime_error("TranslationFile: Cannot memory map file " + filename);
+  }
+  this->ptr = static_cast<char*>(temp_ptr);
+}
+
+TranslationFile::~TranslationFile()
+{
+  if(this->ptr != nullptr)
+  {
+    ::munmap(static_cast<void*>(this->ptr), this->file_size);
+  }
+  if(this->fd >= 0)
+  {
+    ::close(this->fd);
+  }
+}
+
+// (node range, segment name) pairs. The names point to the memory-mapped file.
+typedef std::vector<std::pair<std::pair<nid_t, nid_t>, view_type>> translation_table;
+
+// Parses a `T` line in `[iter, end)` and appends it to the table.
+// Returns false if the line is invalid.
+bool
+parse_translation_line(const char* iter, const char* end, translation_table& table)
+{
+  if(end - iter < 2 || iter[0] != 'T' || iter[1] != '\t') { return false; }
+  iter += 2;
+  const char* name_end = std::find(iter, end, '\t');
+  if(name_end == iter || name_end == end) { return false; }
+  view_type name(iter, name_end - iter);
+  iter = name_end + 1;
+
+  // The node ids must be consecutive.
+  nid_t first = 0, limit = 0;
+  while(true)
+  {
+    if(iter == end || *iter < '0' || *iter > '9') { return false; }
+    nid_t id = 0;
+    while(iter != end && *iter >= '0' && *iter <= '9')
+    {
+      id = 10 * id + (*iter - '0'); ++iter;
+    }
+    if(limit == 0) { first = id; }
+    else if(id != limit) { return false; }
+    limit = id + 1;
+    if(iter == end) { break; }
+    if(*iter != ',') { return false; }
+    ++iter;
+  }
+  if(first == 0) { return false; }
+
+  table.emplace_back(std::make_pair(first, limit), name);
+  return true;
+}
+
+// Parses the translation table in parallel and returns it sorted by node ranges.
+translation_table
+parse_translation(const TranslationFile& file)
+{
+  // Split the file into blocks at line boundaries.
+  size_t blocks = 4 * omp_get_max_threads();
+  std::vector<const char*> boundaries(blocks + 1, file.end());
+  boundaries[0] = file.begin();
+  for(size_t block = 1; block < blocks; block++)
+  {
+    const char* iter = std::max(file.begin() + block * (file.file_size / blocks), boundaries[block - 1]);
+    if(iter != file.begin() && iter != file.end() && iter[-1] != '\n')
+    {
+      iter = std::find(iter, file.end(), '\n');
+      if(iter != file.end()) { ++iter; }
+    }
+    boundaries[block] = iter;
+  }
+
+  std::vector<translation_table> tables(blocks);
+  std::vector<std::string> errors(blocks);
+  #pragma omp parallel for schedule(dynamic, 1)
+  for(size_t block = 0; block < blocks; block++)
+  {
+    const char* iter = boundaries[block];
+    const char* end = boundaries[block + 1];
+    while(iter < end)
+    {
+      const char* line_end = std::find(iter, end, '\n');
+      if(line_end != iter && !parse_translation_line(iter, line_end, tables[block]))
+      {
+        errors[block] = "Invalid translation line: " + std::string(iter, line_end);
+        break;
+      }
+      iter = (line_end == end ? end : line_end + 1);
+    }
+  }
+  for(const std::string& error : errors)
+  {
+    if(!(error.empty())) { throw std::runtime_error("load_translation(): " + error); }
+  }
+
+  // Concatenate the tables. They are usually already in sorted order.
+  translation_table result;
+  size_t total = 0;
+  for(const translation_table& table : tables) { total += table.size(); }
+  result.reserve(total);
+  for(translation_table& table : tables)
+  {
+    result.insert(result.end(), table.begin(), table.end());
+    translation_table().swap(table);
+  }
+  if(!std::is_sorted(result.begin(), result.end()))
+  {
+    gbwt::parallelQuickSort(result.begin(), result.end());
+  }
+  for(size_t i = 1; i < result.size(); i++)
+  {
+    if(result[i - 1].first.second > result[i].first.first)
+    {
+      throw std::runtime_error("load_translation(): Overlapping node ranges for segments " +
+        std::string(result[i - 1].second.first, result[i - 1].second.second) + " and " +
+        std::string(result[i].second.first, result[i].second.second));
+    }
+  }
+
+  return result;
+}
+
+void
+load_translation(const std::string& filename, SequenceSource& source)
+{
+  TranslationFile file(filename);
+  translation_table table = parse_translation(file);
+
+  source.segment_translation.clear();
+  source.segment_translation.reserve(table.size());
+  for(auto& translation : table)
+  {
+    std::string name(translation.second.first, translation.second.second);
+    if(!(source.segment_translation.emplace(name, translation.first).second))
+    {
+      throw std::runtime_error("load_translation(): Duplicate segment " + name);
+    }
+  }
+  if(!(table.empty())) { source.next_id = std::max(source.next_id, table.back().first.second); }
+}
+
+void
+load_translation(const std::string& filename, GBWTGraph& graph)
+{
+  if(graph.index == nullptr)
+  {
+    throw std::runtime_error("load_translation(): The graph does not have a GBWT index");
+  }
+
+  TranslationFile file(filename);
+  translation_table table = parse_translation(file);
+  nid_t first_id = (graph.index->empty() ? 0 : gbwt::Node::id(graph.index->firstNode()));
+  nid_t universe = (graph.index->empty() ? 0 : gbwt::Node::id(graph.index->sigma()));
+  if(!(table.empty()) && table.back().first.second > universe)
+  {
+    throw std::runtime_error("load_translation(): Node ids exceed the GBWT alphabet");
+  }
+
+  // Runs of node ids not covered by the translation become segments with
+  // empty names. Segments without nodes in the graph also get empty names.
+  // Nodes in the graph must be covered by the translation.
+  view_type empty(nullptr, 0);
+  std::vector<std::pair<nid_t, view_type>> starts;
+  starts.reserve(2 * table.size() + 1);
+  auto add_gap = [&](nid_t start, nid_t limit)
+  {
+    if(start >= limit) { return; }
+    for(nid_t id = start; id < limit; id++)
+    {
+      if(graph.has_node(id))
+      {
+        throw std::runtime_error("load_translation(): Node " + std::to_string(id) + " is not in the translation");
+      }
+    }
+    starts.emplace_back(start, empty);
+  };
+  if(!(table.empty())) { add_gap(first_id, table.front().first.first); }
+  for(size_t i = 0; i < table.size(); i++)
+  {
+    if(i > 0) { add_gap(table[i - 1].first.second, table[i].first.first); }
+    nid_t first = table[i].first.first;
+    starts.emplace_back(first, (graph.has_node(first) ? table[i].second : empty));
+  }
+  if(!(table.empty())) { add_gap(table.back().first.second, universe); }
+
+  if(starts.empty())
+  {
+    graph.segments = gbwt::StringArray();
+    graph.node_to_segment = sdsl::sd_vector<>();
+    graph.header.unset(GBWTGraph::Header::FLAG_TRANSLATION);
+    return;
+  }
+
+  graph.segments = gbwt::StringArray(starts.size(),
+  [&](size_t offset) -> size_t
+  {
+    return starts[offset].second.second;
+  },
+  [&](size_t offset) -> view_type
+  {
+    return starts[offset].second;
+  });
+  sdsl::sd_vector_builder builder(universe, starts.size());
+  for(auto& start : starts) { builder.set_unsafe(start.first); }
+  graph.node_to_segment = sdsl::sd_vector<>(builder);
+  graph.header.set(GBWTGraph::Header::FLAG_TRANSLATION);
+}
+
+//------------------------------------------------------------------------------
+
 } // namespace gbwtgraph
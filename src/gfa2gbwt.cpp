@@ -3,6 +3,7 @@
 #include <string>
 
 #include <getopt.h>
+#include <omp.h>
 #include <unistd.h>
 
 #include <gbwtgraph/gbz.h>
@@ -14,7 +15,7 @@ using namespace gbwtgraph;
 //------------------------------------------------------------------------------
 
 enum input_type { input_gfa, input_gbz, input_graph };
-enum output_type { output_gfa, output_gbz, output_graph, output_none };
+enum output_type { output_gfa, output_gbz, output_graph, output_fasta, output_none };
 
 struct Config
 {
@@ -22,12 +23,14 @@ struct Config
 
   GFAParsingParameters parameters;
   GFAExtractionParameters output_parameters;
+  FASTAExtractionParameters fasta_parameters;
   std::string basename;
 
   input_type input = input_gfa;
   output_type output = output_gbz;
 
   bool translation = false;
+  std::string translation_file;
   bool show_progress = false;
   bool simple_sds_graph = false;
   bool bitvectors = false;
@@ -42,8 +45,10 @@ void load_graph(GBZ& gbz, const Config& config);
 void write_gfa(const GBZ& gbz, const Config& config);
 void write_gbz(const GBZ& gbz, const Config& config);
 void write_graph(const GBZ& gbz, const Config& config);
+void write_fasta(const GBZ& gbz, const Config& config); // May throw `std::runtime_error`.
 
 void extract_translation(const GBZ& gbz, const Config& config);
+void import_translation(GBZ& gbz, const Config& config); // May throw `std::runtime_error`.
 void extract_bitvectors(const GBZ& gbz, const Config& config);
 
 //------------------------------------------------------------------------------
@@ -74,6 +79,13 @@ main(int argc, char** argv)
       gbwt::printHeader("--cache-records", std::cerr) << config.output_parameters.large_record_bytes << std::endl;
       gbwt::printHeader("--paths", std::cerr) << GFAExtractionParameters::mode_name(config.output_parameters.mode) << std::endl;
     }
+    if(config.output == output_fasta)
+    {
+      gbwt::printHeader("--parallel-jobs", std::cerr) << config.fasta_parameters.num_threads << std::endl;
+      gbwt::printHeader("--cache-records", std::cerr) << config.fasta_parameters.large_record_bytes << std::endl;
+      gbwt::printHeader("--line-length", std::cerr) << config.fasta_parameters.line_length << std::endl;
+      gbwt::printHeader("--unordered", std::cerr) << !(config.fasta_parameters.ordered) << std::endl;
+    }
     std::cerr << std::endl;
   }
 
@@ -96,6 +108,10 @@ main(int argc, char** argv)
     {
       load_graph(gbz, config);
     }
+    if(!(config.translation_file.empty()))
+    {
+      import_translation(gbz, config);
+    }
 
     // Handle the output.
     if(config.output == output_gfa)
@@ -110,6 +126,10 @@ main(int argc, char** argv)
     {
       write_graph(gbz, config);
     }
+    else if(config.output == output_fasta)
+    {
+      write_fasta(gbz, config);
+    }
 
     // Extract parts of the GBZ.
     if(config.translation)
@@ -158,10 +178,13 @@ printUsage(int exit_code)
   std::cerr << "  -e, --extract-gfa       read " << gbwt::GBWT::EXTENSION << " and " << GBWTGraph::EXTENSION << ", write " << GFA_EXTENSION << std::endl;
   std::cerr << "  -C, --compress-graph    read " << gbwt::GBWT::EXTENSION << " and " << GBWTGraph::EXTENSION << ", write " << GBZ::EXTENSION << std::endl;
   std::cerr << "  -D, --decompress-graph  read " << GBZ::EXTENSION << ", write " << gbwt::GBWT::EXTENSION << " and " << GBWTGraph::EXTENSION << std::endl;
+  std::cerr << "  -F, --extract-fasta     read " << GBZ::EXTENSION << ", write path sequences to " << FASTA_EXTENSION << std::endl;
   std::cerr << std::endl;
   std::cerr << "General options:" << std::endl;
   std::cerr << "  -p, --progress          show progress information" << std::endl;
   std::cerr << "  -t, --translation       write translation table into a " << SequenceSource::TRANSLATION_EXTENSION << " file" << std::endl;
+  std::cerr << "      --load-translation FILE" << std::endl;
+  std::cerr << "                          replace the translation in the input graph with a table from FILE" << std::endl;
   std::cerr << std::endl;
   std::cerr << "Parallel options:" << std::endl;
   std::cerr << "  -j, --approx-jobs N     create approximately N GBWT construction jobs (default " << GFAParsingParameters::APPROXIMATE_NUM_JOBS << ")" << std::endl;
@@ -170,14 +193,22 @@ printUsage(int exit_code)
   std::cerr << "Output options:" << std::endl;
   std::cerr << "  -R, --cache-records N   cache > N-byte GBWT records for " << GFA_EXTENSION << " output (default " << GFAExtractionParameters::LARGE_RECORD_BYTES << ")" << std::endl;
   std::cerr << "  -s, --simple-sds-graph  serialize " << GBWTGraph::EXTENSION << " in simple-sds format instead of libhandlegraph format" << std::endl;
-  std::cerr << "                          (this tool cannot read simple-sds graphs)" << std::endl;
   std::cerr << "      --paths STR         extract paths as STR (default, pan-sn, ref-only)" << std::endl;
   std::cerr << "      --pan-sn            extract paths as P-lines with PanSN names" << std::endl;
   std::cerr << "      --ref-only          extract only named paths as P-lines" << std::endl;
   std::cerr << std::endl;
+  std::cerr << "FASTA output options:" << std::endl;
+  std::cerr << "      --sample STR        extract paths for sample STR (may repeat; default: all)" << std::endl;
+  std::cerr << "      --contig STR        extract paths for contig STR (may repeat; default: all)" << std::endl;
+  std::cerr << "      --line-length N     break sequence lines after N bp (default " << FASTAExtractionParameters::LINE_LENGTH << "; 0 = no breaks)" << std::endl;
+  std::cerr << "      --unordered         write the paths in any order" << std::endl;
+  std::cerr << std::endl;
   std::cerr << "GFA parsing parameters:" << std::endl;
   std::cerr << "  -m, --max-node N        break > N bp segments into multiple nodes (default " << MAX_NODE_LENGTH << ")" << std::endl;
   std::cerr << "                          (minimizer index requires nodes of length <= 1024 bp)" << std::endl;
+  std::cerr << "      --renumber          renumber the nodes in topological order for locality" << std::endl;
+  std::cerr << "      --unchop            merge non-branching chains into single nodes" << std::endl;
+  std::cerr << "                          (requires integer segment names and no chopping or renumbering)" << std::endl;
   std::cerr << "  -r, --path-regex STR    parse path names using regex STR (default " << GFAParsingParameters::DEFAULT_REGEX << ")" << std::endl;
   std::cerr << "  -f, --path-fields STR   map the submatches to fields STR (default " << GFAParsingParameters::DEFAULT_FIELDS << ")" << std::endl;
   std::cerr << "                          (the first submatch is the entire path name)" << std::endl;
@@ -205,6 +236,13 @@ Config::Config(int argc, char** argv)
   constexpr int OPT_PAN_SN = 1001;
   constexpr int OPT_REF_ONLY = 1002;
   constexpr int OPT_PATH_SENSE = 1003;
+  constexpr int OPT_LOAD_TRANSLATION = 1004;
+  constexpr int OPT_SAMPLE = 1005;
+  constexpr int OPT_CONTIG = 1006;
+  constexpr int OPT_LINE_LENGTH = 1007;
+  constexpr int OPT_UNORDERED = 1008;
+  constexpr int OPT_RENUMBER = 1009;
+  constexpr int OPT_UNCHOP = 1010;
 
   // Data for `getopt_long()`.
   int c = 0, option_index = 0;
@@ -216,10 +254,12 @@ Config::Config(int argc, char** argv)
     { "extract-gfa", no_argument, 0, 'e' },
     { "compress-graph", no_argument, 0, 'C' },
     { "decompress-graph", no_argument, 0, 'D' },
+    { "extract-fasta", no_argument, 0, 'F' },
     { "load-gbz", no_argument, 0, 'l' }, // Hidden.
     { "bitvectors", no_argument, 0, 'B' }, // Hidden.
     { "progress", no_argument, 0, 'p' },
     { "translation", no_argument, 0, 't' },
+    { "load-translation", required_argument, 0, OPT_LOAD_TRANSLATION },
     { "approx-jobs", required_argument, 0, 'j' },
     { "parallel-jobs", required_argument, 0, 'P' },
     { "cache-records", required_argument, 0, 'R' },
@@ -227,14 +267,20 @@ Config::Config(int argc, char** argv)
     { "paths", required_argument, 0, OPT_PATHS },
     { "pan-sn", no_argument, 0, OPT_PAN_SN },
     { "ref-only", no_argument, 0, OPT_REF_ONLY },
+    { "sample", required_argument, 0, OPT_SAMPLE },
+    { "contig", required_argument, 0, OPT_CONTIG },
+    { "line-length", required_argument, 0, OPT_LINE_LENGTH },
+    { "unordered", no_argument, 0, OPT_UNORDERED },
     { "max-node", required_argument, 0, 'm' },
+    { "renumber", no_argument, 0, OPT_RENUMBER },
+    { "unchop", no_argument, 0, OPT_UNCHOP },
     { "path-regex", required_argument, 0, 'r' },
     { "path-fields", required_argument, 0, 'f' },
     { "path-sense", required_argument, 0, OPT_PATH_SENSE },
   };
 
   // Process options.
-  while((c = getopt_long(argc, argv, "cdbeCDlBptj:P:R:sm:r:f:", long_options, &option_index)) != -1)
+  while((c = getopt_long(argc, argv, "cdbeCDFlBptj:P:R:sm:r:f:", long_options, &option_index)) != -1)
   {
     switch(c)
     {
@@ -262,6 +308,10 @@ Config::Config(int argc, char** argv)
       this->input = input_gbz;
       this->output = output_graph;
       break;
+    case 'F':
+      this->input = input_gbz;
+      this->output = output_fasta;
+      break;
 
     case 'l':
       this->input = input_gbz;
@@ -275,10 +325,14 @@ Config::Config(int argc, char** argv)
       this->show_progress = true;
       this->parameters.show_progress = true;
       this->output_parameters.show_progress = true;
+      this->fasta_parameters.show_progress = true;
       break;
     case 't':
       this->translation = true;
       break;
+    case OPT_LOAD_TRANSLATION:
+      this->translation_file = optarg;
+      break;
 
     case 'j':
       try { this->parameters.approximate_num_jobs = std::stoul(optarg); }
@@ -296,6 +350,7 @@ Config::Config(int argc, char** argv)
         std::exit(EXIT_FAILURE);
       }
       this->output_parameters.num_threads = this->parameters.parallel_jobs;
+      this->fasta_parameters.num_threads = this->parameters.parallel_jobs;
       break;
 
     case 'R':
@@ -305,6 +360,7 @@ Config::Config(int argc, char** argv)
         std::cerr << "gfa2gbwt: Invalid record caching threshold: " << optarg << std::endl;
         std::exit(EXIT_FAILURE);
       }
+      this->fasta_parameters.large_record_bytes = this->output_parameters.large_record_bytes;
       break;
     case 's':
       this->simple_sds_graph = true;
@@ -329,6 +385,23 @@ Config::Config(int argc, char** argv)
     case OPT_REF_ONLY:
       this->output_parameters.mode = GFAExtractionParameters::mode_ref_only;
       break;
+    case OPT_SAMPLE:
+      this->fasta_parameters.samples.insert(optarg);
+      break;
+    case OPT_CONTIG:
+      this->fasta_parameters.contigs.insert(optarg);
+      break;
+    case OPT_LINE_LENGTH:
+      try { this->fasta_parameters.line_length = std::stoul(optarg); }
+      catch(const std::invalid_argument&)
+      {
+        std::cerr << "gfa2gbwt: Invalid line length: " << optarg << std::endl;
+        std::exit(EXIT_FAILURE);
+      }
+      break;
+    case OPT_UNORDERED:
+      this->fasta_parameters.ordered = false;
+      break;
 
     case 'm':
       try { this->parameters.max_node_length = std::stoul(optarg); }
@@ -338,6 +411,12 @@ Config::Config(int argc, char** argv)
         std::exit(EXIT_FAILURE);
       }
       break;
+    case OPT_RENUMBER:
+      this->parameters.renumber_nodes = true;
+      break;
+    case OPT_UNCHOP:
+      this->parameters.unchop_chains = true;
+      break;
     case 'r':
       this->parameters.path_name_formats.front().regex = optarg;
       break;
@@ -365,6 +444,11 @@ Config::Config(int argc, char** argv)
   }
 
   // Sanity checks.
+  if(this->parameters.unchop_chains && this->parameters.renumber_nodes)
+  {
+    std::cerr << "gfa2gbwt: --unchop cannot be used with --renumber" << std::endl;
+    std::exit(EXIT_FAILURE);
+  }
   if(optind >= argc) { printUsage(EXIT_FAILURE); }
   this->basename = argv[optind]; optind++;
 }
@@ -454,6 +538,22 @@ write_graph(const GBZ& gbz, const Config& config)
   gbz.serialize_to_files(gbwt_name, graph_name, config.simple_sds_graph);
 }
 
+void
+write_fasta(const GBZ& gbz, const Config& config)
+{
+  std::string fasta_name = config.basename + FASTA_EXTENSION;
+
+  if(config.show_progress)
+  {
+    std::cerr << "Writing path sequences to " << fasta_name << std::endl;
+  }
+  std::ofstream out;
+  out.exceptions(std::ofstream::failbit | std::ofstream::badbit);
+  out.open(fasta_name, std::ios_base::binary);
+  gbwt_to_fasta(gbz.graph, out, config.fasta_parameters);
+  out.close();
+}
+
 //------------------------------------------------------------------------------
 
 void
@@ -466,19 +566,18 @@ extract_translation(const GBZ& gbz, const Config& config)
   }
 
   std::ofstream out(translation_name, std::ios_base::binary);
-  TSVWriter writer(out);
-  gbz.graph.for_each_segment([&](const std::string& name, std::pair<nid_t, nid_t> nodes) -> bool
+  write_translation(gbz.graph, out, config.output_parameters);
+}
+
+void
+import_translation(GBZ& gbz, const Config& config)
+{
+  if(config.show_progress)
   {
-    writer.put('T'); writer.newfield();
-    writer.write(name); writer.newfield();
-    writer.write(nodes.first);
-    for(nid_t i = nodes.first + 1; i < nodes.second; i++)
-    {
-      writer.put(','); writer.write(i);
-    }
-    writer.newline();
-    return true;
-  });
+    std::cerr << "Loading the translation table from " << config.translation_file << std::endl;
+  }
+  omp_set_num_threads(config.output_parameters.threads());
+  load_translation(config.translation_file, gbz.graph);
 }
 
 sdsl::bit_vector
@@ -0,0 +1,65 @@
+#include <gbwtgraph/kmer.h>
+
+namespace gbwtgraph
+{
+
+//------------------------------------------------------------------------------
+
+// KmerHeader: Numerical class constants.
+
+constexpr std::uint32_t KmerHeader::TAG;
+constexpr std::uint32_t KmerHeader::VERSION;
+constexpr std::uint64_t KmerHeader::FLAG_MASK;
+constexpr std::uint64_t KmerHeader::FLAG_KEY_MASK;
+constexpr size_t KmerHeader::FLAG_KEY_OFFSET;
+constexpr std::uint64_t KmerHeader::FLAG_CANONICAL;
+
+//------------------------------------------------------------------------------
+
+KmerHeader::KmerHeader() :
+  tag(TAG), version(VERSION),
+  k(0), kmers(0), total_count(0),
+  flags(0)
+{
+}
+
+KmerHeader::KmerHeader(size_t kmer_length, size_t key_bits, bool canonical) :
+  tag(TAG), version(VERSION),
+  k(kmer_length), kmers(0), total_count(0),
+  flags((key_bits << FLAG_KEY_OFFSET) & FLAG_KEY_MASK)
+{
+  if(canonical) { this->set(FLAG_CANONICAL); }
+}
+
+void
+KmerHeader::check() const
+{
+  if(this->tag != TAG)
+  {
+    throw sdsl::simple_sds::InvalidData("KmerHeader: Invalid tag");
+  }
+
+  if(this->version != VERSION)
+  {
+    std::string msg = "KmerHeader: Expected v" + std::to_string(VERSION) + ", got v" + std::to_string(this->version);
+    throw sdsl::simple_sds::InvalidData(msg);
+  }
+
+  std::uint64_t mask = FLAG_MASK;
+  if((this->flags & mask) != this->flags)
+  {
+    throw sdsl::simple_sds::InvalidData("KmerHeader: Invalid flags");
+  }
+}
+
+bool
+KmerHeader::operator==(const KmerHeader& another) const
+{
+  return (this->tag == another.tag && this->version == another.version &&
+          this->k == another.k && this->kmers == another.kmers && this->total_count == another.total_count &&
+          this->flags == another.flags);
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace gbwtgraph
@@ -15,6 +15,21 @@ constexpr std::uint64_t MinimizerHeader::FLAG_MASK;
 constexpr std::uint64_t MinimizerHeader::FLAG_KEY_MASK;
 constexpr size_t MinimizerHeader::FLAG_KEY_OFFSET;
 constexpr std::uint64_t MinimizerHeader::FLAG_SYNCMERS;
+constexpr std::uint64_t MinimizerHeader::FLAG_HAPLOTYPE_COUNTS;
+
+//------------------------------------------------------------------------------
+
+// payload_type: Numerical class constants.
+
+constexpr size_t payload_type::HAPLOTYPE_BITS;
+constexpr size_t payload_type::HAPLOTYPE_OFFSET;
+constexpr std::uint64_t payload_type::HAPLOTYPE_MASK;
+
+//------------------------------------------------------------------------------
+
+// SubgraphBitmap: Numerical class constants.
+
+constexpr size_t SubgraphBitmap::MAX_BITS_PER_NODE;
 
 //------------------------------------------------------------------------------
 
@@ -412,6 +427,13 @@ Key64::encode(const std::string& sequence)
   return Key64(packed);
 }
 
+void
+Key64::hash_keys(const Key64* keys, size_t* hashes, size_t n)
+{
+  for(size_t i = 0; i < n; i++) { hashes[i] = keys[i].key & KEY_MASK; }
+  wang_hash_64(hashes, hashes, n);
+}
+
 std::string
 Key64::decode(size_t k) const
 {
@@ -455,6 +477,12 @@ Key128::encode(const std::string& sequence)
   return Key128(packed_high, packed_low);
 }
 
+void
+Key128::hash_keys(const Key128* keys, size_t* hashes, size_t n)
+{
+  for(size_t i = 0; i < n; i++) { hashes[i] = keys[i].hash(); }
+}
+
 std::string
 Key128::decode(size_t k) const
 {
@@ -484,71 +512,21 @@ void
 hits_in_subgraph(size_t hit_count, const hit_type* hits, const std::unordered_set<nid_t>& subgraph,
                  const std::function<void(pos_t, payload_type)>& report_hit)
 {
-  for(const hit_type* ptr = hits; ptr < hits + hit_count; ++ptr)
-  {
-    auto iter = subgraph.find(Position::id(ptr->pos));
-    if(iter != subgraph.end()) { report_hit(Position::decode(ptr->pos), ptr->payload); }
-  }
+  hits_in_subgraph<std::function<void(pos_t, payload_type)>>(hit_count, hits, subgraph, report_hit);
 }
 
-/*
-  Exponential search that returns the first offset with get_value(offset) >= target.
-  We assume that start < limit and get_value(start) < target.
-  Returns limit if get_value(offset) < target for all offset < limit.
-*/
-size_t
-exponential_search(size_t start, size_t limit, nid_t target, const std::function<nid_t(size_t)>& get_value)
+void
+hits_in_subgraph(size_t hit_count, const hit_type* hits, const std::vector<nid_t>& subgraph,
+                 const std::function<void(pos_t, payload_type)>& report_hit)
 {
-  // Exponential search: low is too early.
-  size_t step = 1;
-  size_t low = start, candidate = start + step;
-  while(candidate < limit && get_value(candidate) < target)
-  {
-    step *= 2;
-    low = candidate; candidate += step;
-  }
-
-  // Binary search: low + 1 is the first candidate while candidate is the last.
-  low++;
-  size_t count = std::min(limit, candidate + 1) - low;
-  while(count > 0)
-  {
-    step = count / 2;
-    candidate = low + step;
-    if(get_value(candidate) < target) { low = candidate + 1; count -= step + 1; }
-    else { count = step; }
-  }
-  return low;
+  hits_in_subgraph<std::function<void(pos_t, payload_type)>>(hit_count, hits, subgraph, report_hit);
 }
 
 void
-hits_in_subgraph(size_t hit_count, const hit_type* hits, const std::vector<nid_t>& subgraph,
+hits_in_subgraph(size_t hit_count, const hit_type* hits, const SubgraphBitmap& subgraph,
                  const std::function<void(pos_t, payload_type)>& report_hit)
 {
-  size_t hit_offset = 0, subgraph_offset = 0;
-  while(hit_offset < hit_count && subgraph_offset < subgraph.size())
-  {
-    nid_t node = Position::id(hits[hit_offset].pos);
-    if(node < subgraph[subgraph_offset])
-    {
-      hit_offset = exponential_search(hit_offset, hit_count, subgraph[subgraph_offset], [&](size_t offset) -> nid_t
-      {
-        return Position::id(hits[offset].pos);
-      });
-    }
-    else if(node > subgraph[subgraph_offset])
-    {
-      subgraph_offset = exponential_search(subgraph_offset, subgraph.size(), node, [&](size_t offset) -> nid_t
-      {
-        return subgraph[offset];
-      });
-    }
-    else
-    {
-      report_hit(Position::decode(hits[hit_offset].pos), hits[hit_offset].payload);
-      ++hit_offset;
-    }
-  }
+  hits_in_subgraph<std::function<void(pos_t, payload_type)>>(hit_count, hits, subgraph, report_hit);
 }
 
 //------------------------------------------------------------------------------
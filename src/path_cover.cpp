@@ -256,8 +256,9 @@ struct LocalHaplotypes
     BestCoverage<LocalHaplotypes> best;
     auto start = (path.size() + 1 < k ? path.begin() : path.end() - (k - 1));
     std::vector<handle_t> context(start, path.end());
-    gbwt::BidirectionalState state = graph.bd_find(context);
-    graph.follow_paths(state, false, [&](const gbwt::BidirectionalState& next) -> bool
+    gbwt::CachedGBWT cache = graph.get_single_cache();
+    gbwt::BidirectionalState state = graph.bd_find(cache, context);
+    graph.for_each_extension(cache, state, false, [&](const gbwt::BidirectionalState& next) -> bool
     {
       success = true;
       handle_t handle = GBWTGraph::node_to_handle(next.forward.node);
@@ -300,8 +301,9 @@ struct LocalHaplotypes
     BestCoverage<LocalHaplotypes> best;
     auto limit = (path.size() + 1 < k ? path.end() : path.begin() + (k - 1));
     std::vector<handle_t> context(path.begin(), limit);
-    gbwt::BidirectionalState state = graph.bd_find(context);
-    graph.follow_paths(state, true, [&](const gbwt::BidirectionalState& prev) -> bool
+    gbwt::CachedGBWT cache = graph.get_single_cache();
+    gbwt::BidirectionalState state = graph.bd_find(cache, context);
+    graph.for_each_extension(cache, state, true, [&](const gbwt::BidirectionalState& prev) -> bool
     {
       success = true;
       handle_t handle = GBWTGraph::node_to_handle(prev.backward.node);
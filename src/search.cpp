@@ -0,0 +1,288 @@
+#include <gbwtgraph/search.h>
+
+#include <algorithm>
+#include <cstring>
+#include <stack>
+
+namespace gbwtgraph
+{
+
+//------------------------------------------------------------------------------
+
+bool
+SequenceMatch::operator<(const SequenceMatch& another) const
+{
+  size_t common = std::min(this->path.size(), another.path.size());
+  for(size_t i = 0; i < common; i++)
+  {
+    gbwt::node_type a = GBWTGraph::handle_to_node(this->path[i]);
+    gbwt::node_type b = GBWTGraph::handle_to_node(another.path[i]);
+    if(a != b) { return (a < b); }
+  }
+  if(this->path.size() != another.path.size()) { return (this->path.size() < another.path.size()); }
+  return (this->offset < another.offset);
+}
+
+bool
+SequenceMatch::operator==(const SequenceMatch& another) const
+{
+  return (this->path == another.path && this->offset == another.offset);
+}
+
+//------------------------------------------------------------------------------
+
+// A partial match extended to the right.
+struct RightExtension
+{
+  gbwt::BidirectionalState state;
+  std::vector<handle_t>    path;
+  size_t                   query_offset; // Next query base to match.
+  size_t                   node_offset;  // Next base in the last node.
+};
+
+// A partial match extended to the left. The prefix contains the nodes before the
+// anchor node in reverse order.
+struct LeftExtension
+{
+  gbwt::BidirectionalState state;
+  std::vector<handle_t>    prefix;
+  size_t                   remaining; // Query bases before the matched suffix.
+  size_t                   node_end;  // Bases available in the first node.
+};
+
+void
+extend_anchor(const GBWTGraph& graph, const gbwt::CachedGBWT& cache,
+              const std::string& query, size_t query_offset, pos_t graph_pos,
+              std::vector<SequenceMatch>& output)
+{
+  if(query_offset >= query.length() || !(graph.has_node(id(graph_pos)))) { return; }
+  handle_t anchor = graph.get_handle(id(graph_pos), is_rev(graph_pos));
+  if(offset(graph_pos) >= graph.get_length(anchor)) { return; }
+  gbwt::BidirectionalState initial = graph.get_bd_state(cache, anchor);
+  if(initial.empty()) { return; }
+
+  // Extend to the right until the query ends.
+  std::vector<RightExtension> right_matches;
+  std::stack<RightExtension> right;
+  right.push({ initial, { anchor }, query_offset, offset(graph_pos) });
+  while(!(right.empty()))
+  {
+    RightExtension curr = std::move(right.top()); right.pop();
+    view_type sequence = graph.get_sequence_view(curr.path.back());
+    size_t length = std::min(sequence.second - curr.node_offset, query.length() - curr.query_offset);
+    if(std::memcmp(sequence.first + curr.node_offset, query.data() + curr.query_offset, length) != 0) { continue; }
+    curr.query_offset += length;
+    if(curr.query_offset >= query.length())
+    {
+      right_matches.push_back(std::move(curr));
+      continue;
+    }
+    graph.for_each_extension(cache, curr.state, false, [&](const gbwt::BidirectionalState& next_state) -> bool
+    {
+      RightExtension next { next_state, curr.path, curr.query_offset, 0 };
+      next.path.push_back(GBWTGraph::node_to_handle(next_state.forward.node));
+      right.push(std::move(next));
+      return true;
+    });
+  }
+
+  // Extend each right match to the left until the query starts.
+  for(const RightExtension& right_match : right_matches)
+  {
+    std::stack<LeftExtension> left;
+    left.push({ right_match.state, { }, query_offset, offset(graph_pos) });
+    while(!(left.empty()))
+    {
+      LeftExtension curr = std::move(left.top()); left.pop();
+      handle_t handle = (curr.prefix.empty() ? anchor : curr.prefix.back());
+      view_type sequence = graph.get_sequence_view(handle);
+      size_t length = std::min(curr.remaining, curr.node_end);
+      if(std::memcmp(sequence.first + curr.node_end - length, query.data() + curr.remaining - length, length) != 0) { continue; }
+      curr.remaining -= length;
+      if(curr.remaining == 0)
+      {
+        SequenceMatch match { std::vector<handle_t>(curr.prefix.rbegin(), curr.prefix.rend()), curr.node_end - length, curr.state };
+        match.path.insert(match.path.end(), right_match.path.begin(), right_match.path.end());
+        output.push_back(std::move(match));
+        continue;
+      }
+      graph.for_each_extension(cache, curr.state, true, [&](const gbwt::BidirectionalState& next_state) -> bool
+      {
+        handle_t prev = GBWTGraph::node_to_handle(gbwt::Node::reverse(next_state.backward.node));
+        LeftExtension next { next_state, curr.prefix, curr.remaining, graph.get_length(prev) };
+        next.prefix.push_back(prev);
+        left.push(std::move(next));
+        return true;
+      });
+    }
+  }
+}
+
+void
+sort_matches(std::vector<SequenceMatch>& matches)
+{
+  std::sort(matches.begin(), matches.end());
+  matches.erase(std::unique(matches.begin(), matches.end()), matches.end());
+}
+
+std::vector<SequenceMatch>
+find_haplotype_matches(const GBWTGraph& graph, const gbwt::CachedGBWT& cache, const std::string& query)
+{
+  std::vector<SequenceMatch> result;
+  if(query.empty()) { return result; }
+
+  graph.for_each_node([&](const handle_t& handle) -> bool
+  {
+    for(bool is_reverse : { false, true })
+    {
+      handle_t oriented = (is_reverse ? graph.flip(handle) : handle);
+      view_type sequence = graph.get_sequence_view(oriented);
+      for(size_t i = 0; i < sequence.second; i++)
+      {
+        if(sequence.first[i] != query.front()) { continue; }
+        extend_anchor(graph, cache, query, 0, make_pos_t(graph.get_id(oriented), is_reverse, i), result);
+      }
+    }
+    return true;
+  });
+  sort_matches(result);
+
+  return result;
+}
+
+std::vector<std::vector<SequenceMatch>>
+find_haplotype_matches(const GBWTGraph& graph, const std::vector<std::string>& queries)
+{
+  std::vector<std::vector<SequenceMatch>> result(queries.size());
+  #pragma omp parallel
+  {
+    gbwt::CachedGBWT cache = graph.get_cache();
+    #pragma omp for schedule(dynamic, 1)
+    for(size_t i = 0; i < queries.size(); i++)
+    {
+      result[i] = find_haplotype_matches(graph, cache, queries[i]);
+    }
+  }
+  return result;
+}
+
+//------------------------------------------------------------------------------
+
+// A range of paths in sorted order that share a prefix of the given length, and
+// the search state for the prefix.
+struct PathTrieNode
+{
+  size_t            begin, end;
+  size_t            depth;
+  gbwt::SearchState state;
+};
+
+void
+find_subtrie(const gbwt::CachedGBWT& cache, const std::vector<std::vector<handle_t>>& paths, const std::vector<size_t>& order,
+             const PathTrieNode& root, std::vector<gbwt::SearchState>& result)
+{
+  std::stack<PathTrieNode> nodes;
+  nodes.push(root);
+  while(!(nodes.empty()))
+  {
+    PathTrieNode curr = nodes.top(); nodes.pop();
+    size_t i = curr.begin;
+
+    // Like GBWTGraph::find(), we stop extending when the state becomes empty.
+    if(curr.state.empty())
+    {
+      for(; i < curr.end; i++) { result[order[i]] = curr.state; }
+      continue;
+    }
+
+    // Paths ending at this trie node come first in lexicographic order.
+    while(i < curr.end && paths[order[i]].size() == curr.depth)
+    {
+      result[order[i]] = curr.state; i++;
+    }
+
+    // Extend the state once for each child.
+    while(i < curr.end)
+    {
+      gbwt::node_type node = GBWTGraph::handle_to_node(paths[order[i]][curr.depth]);
+      size_t j = i + 1;
+      while(j < curr.end && GBWTGraph::handle_to_node(paths[order[j]][curr.depth]) == node) { j++; }
+      nodes.push({ i, j, curr.depth + 1, cache.extend(curr.state, node) });
+      i = j;
+    }
+  }
+}
+
+std::vector<gbwt::SearchState>
+find_paths(const GBWTGraph& graph, const std::vector<std::vector<handle_t>>& paths)
+{
+  std::vector<gbwt::SearchState> result(paths.size());
+
+  // Sort the paths lexicographically by GBWT node identifiers.
+  std::vector<size_t> order(paths.size());
+  for(size_t i = 0; i < order.size(); i++) { order[i] = i; }
+  auto node_order = [](const handle_t& a, const handle_t& b) -> bool
+  {
+    return (GBWTGraph::handle_to_node(a) < GBWTGraph::handle_to_node(b));
+  };
+  std::sort(order.begin(), order.end(), [&](size_t a, size_t b) -> bool
+  {
+    return std::lexicographical_compare(paths[a].begin(), paths[a].end(), paths[b].begin(), paths[b].end(), node_order);
+  });
+
+  // Empty paths come first and get empty states. Each remaining range of paths
+  // starting with the same node is an independent subtrie.
+  std::vector<std::pair<size_t, size_t>> subtries;
+  size_t i = 0;
+  while(i < order.size() && paths[order[i]].empty()) { i++; }
+  while(i < order.size())
+  {
+    handle_t first = paths[order[i]].front();
+    size_t j = i + 1;
+    while(j < order.size() && paths[order[j]].front() == first) { j++; }
+    subtries.emplace_back(i, j);
+    i = j;
+  }
+
+  #pragma omp parallel
+  {
+    gbwt::CachedGBWT cache = graph.get_cache();
+    #pragma omp for schedule(dynamic, 1)
+    for(size_t subtrie = 0; subtrie < subtries.size(); subtrie++)
+    {
+      size_t begin = subtries[subtrie].first, end = subtries[subtrie].second;
+      PathTrieNode root { begin, end, 1, graph.get_state(cache, paths[order[begin]].front()) };
+      find_subtrie(cache, paths, order, root, result);
+    }
+  }
+
+  return result;
+}
+
+std::vector<size_t>
+count_haplotypes(const GBWTGraph& graph, const std::vector<std::vector<handle_t>>& paths)
+{
+  std::vector<gbwt::SearchState> states = find_paths(graph, paths);
+  std::vector<size_t> result(states.size());
+  for(size_t i = 0; i < states.size(); i++) { result[i] = states[i].size(); }
+  return result;
+}
+
+std::vector<std::vector<gbwt::size_type>>
+locate_haplotypes(const GBWTGraph& graph, const std::vector<std::vector<handle_t>>& paths)
+{
+  std::vector<gbwt::SearchState> states = find_paths(graph, paths);
+  std::vector<std::vector<gbwt::size_type>> result(states.size());
+  #pragma omp parallel for schedule(dynamic, 1)
+  for(size_t i = 0; i < states.size(); i++)
+  {
+    if(states[i].empty()) { continue; }
+    result[i] = graph.index->locate(states[i]);
+    std::sort(result[i].begin(), result[i].end());
+  }
+  return result;
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace gbwtgraph
@@ -5,6 +5,12 @@
 
 #include <gbwt/utils.h>
 
+#include <sys/mman.h>
+
+#if defined(__AVX2__) || defined(__SSSE3__)
+#include <immintrin.h>
+#endif
+
 namespace gbwtgraph
 {
 
@@ -18,6 +24,7 @@ constexpr size_t Version::PATCH_VERSION;
 constexpr size_t Version::GBZ_VERSION;
 constexpr size_t Version::GRAPH_VERSION;
 constexpr size_t Version::MINIMIZER_VERSION;
+constexpr size_t Version::KMER_VERSION;
 
 //------------------------------------------------------------------------------
 
@@ -357,6 +364,29 @@ Version::print(std::ostream& out, const std::string& tool_name, bool verbose, si
 
 //------------------------------------------------------------------------------
 
+void
+wang_hash_64(const size_t* keys, size_t* hashes, size_t n)
+{
+  size_t i = 0;
+#if defined(__AVX2__)
+  for(; i + 4 <= n; i += 4)
+  {
+    __m256i key = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(keys + i));
+    key = _mm256_add_epi64(_mm256_xor_si256(key, _mm256_set1_epi64x(-1)), _mm256_slli_epi64(key, 21));
+    key = _mm256_xor_si256(key, _mm256_srli_epi64(key, 24));
+    key = _mm256_add_epi64(_mm256_add_epi64(key, _mm256_slli_epi64(key, 3)), _mm256_slli_epi64(key, 8));
+    key = _mm256_xor_si256(key, _mm256_srli_epi64(key, 14));
+    key = _mm256_add_epi64(_mm256_add_epi64(key, _mm256_slli_epi64(key, 2)), _mm256_slli_epi64(key, 4));
+    key = _mm256_xor_si256(key, _mm256_srli_epi64(key, 28));
+    key = _mm256_add_epi64(key, _mm256_slli_epi64(key, 31));
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(hashes + i), key);
+  }
+#endif
+  for(; i < n; i++) { hashes[i] = wang_hash_64(keys[i]); }
+}
+
+//------------------------------------------------------------------------------
+
 const std::vector<char> complement =
 {
   'N', 'N', 'N', 'N', 'N', 'N', 'N', 'N',   'N', 'N', 'N', 'N', 'N', 'N', 'N', 'N',
@@ -380,29 +410,169 @@ const std::vector<char> complement =
   'N', 'N', 'N', 'N', 'N', 'N', 'N', 'N',   'N', 'N', 'N', 'N', 'N', 'N', 'N', 'N'
 };
 
+inline char
+complement_char(char c)
+{
+  return complement[static_cast<unsigned char>(c)];
+}
+
+/*
+  Vectorized complement. The characters with a complement other than 'N' have high
+  nibble 2, 4, 5, 6, or 7. For each such high nibble, we use the corresponding 16
+  entries of the complement table as a shuffle table indexed by the low nibble.
+*/
+
+constexpr size_t COMPLEMENT_ROWS = 5;
+const unsigned char complement_rows[COMPLEMENT_ROWS] = { 0x2, 0x4, 0x5, 0x6, 0x7 };
+
+#if defined(__SSSE3__)
+
+inline __m128i
+complement_16(__m128i bytes)
+{
+  __m128i low = _mm_and_si128(bytes, _mm_set1_epi8(0x0F));
+  __m128i high = _mm_and_si128(_mm_srli_epi16(bytes, 4), _mm_set1_epi8(0x0F));
+  __m128i result = _mm_set1_epi8('N');
+  for(size_t row = 0; row < COMPLEMENT_ROWS; row++)
+  {
+    __m128i table = _mm_loadu_si128(reinterpret_cast<const __m128i*>(complement.data() + 16 * complement_rows[row]));
+    __m128i values = _mm_shuffle_epi8(table, low);
+    __m128i mask = _mm_cmpeq_epi8(high, _mm_set1_epi8(complement_rows[row]));
+    result = _mm_or_si128(_mm_and_si128(mask, values), _mm_andnot_si128(mask, result));
+  }
+  return result;
+}
+
+inline __m128i
+reverse_complement_16(const char* seq)
+{
+  __m128i bytes = _mm_loadu_si128(reinterpret_cast<const __m128i*>(seq));
+  __m128i reverse = _mm_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  return complement_16(_mm_shuffle_epi8(bytes, reverse));
+}
+
+#endif
+
+#if defined(__AVX2__)
+
+inline __m256i
+complement_32(__m256i bytes)
+{
+  __m256i low = _mm256_and_si256(bytes, _mm256_set1_epi8(0x0F));
+  __m256i high = _mm256_and_si256(_mm256_srli_epi16(bytes, 4), _mm256_set1_epi8(0x0F));
+  __m256i result = _mm256_set1_epi8('N');
+  for(size_t row = 0; row < COMPLEMENT_ROWS; row++)
+  {
+    __m128i half = _mm_loadu_si128(reinterpret_cast<const __m128i*>(complement.data() + 16 * complement_rows[row]));
+    __m256i values = _mm256_shuffle_epi8(_mm256_broadcastsi128_si256(half), low);
+    __m256i mask = _mm256_cmpeq_epi8(high, _mm256_set1_epi8(complement_rows[row]));
+    result = _mm256_or_si256(_mm256_and_si256(mask, values), _mm256_andnot_si256(mask, result));
+  }
+  return result;
+}
+
+inline __m256i
+reverse_complement_32(const char* seq)
+{
+  __m256i bytes = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(seq));
+  __m256i reverse = _mm256_set_epi8(0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15,
+                                    0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15);
+  bytes = _mm256_shuffle_epi8(bytes, reverse);
+  bytes = _mm256_permute2x128_si256(bytes, bytes, 0x01);
+  return complement_32(bytes);
+}
+
+#endif
+
 std::string
 reverse_complement(const std::string& seq)
 {
-  std::string result = seq;
-  reverse_complement_in_place(result);
+  std::string result(seq.length(), 'N');
+  reverse_complement(seq.data(), seq.length(), &result[0]);
   return result;
 }
 
 void
 reverse_complement_in_place(std::string& seq)
 {
-  size_t swap_size = seq.size() / 2;
-  for(size_t i = 0, j = seq.size() - 1; i < swap_size; i++, j--)
+  // Swap blocks from both ends until they would overlap.
+  size_t head = 0, tail = seq.size();
+  char* data = &seq[0];
+#if defined(__AVX2__)
+  while(tail - head >= 64)
+  {
+    __m256i front = reverse_complement_32(data + tail - 32);
+    __m256i back = reverse_complement_32(data + head);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + head), front);
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(data + tail - 32), back);
+    head += 32; tail -= 32;
+  }
+#endif
+#if defined(__SSSE3__)
+  while(tail - head >= 32)
+  {
+    __m128i front = reverse_complement_16(data + tail - 16);
+    __m128i back = reverse_complement_16(data + head);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(data + head), front);
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(data + tail - 16), back);
+    head += 16; tail -= 16;
+  }
+#endif
+
+  // The middle part.
+  while(tail - head >= 2)
   {
-    char tmp = seq[i];
-    seq[i] = complement[seq[j]];
-    seq[j] = complement[tmp];
+    tail--;
+    char tmp = data[head];
+    data[head] = complement_char(data[tail]);
+    data[tail] = complement_char(tmp);
+    head++;
   }
+  if(tail - head == 1) { data[head] = complement_char(data[head]); }
+}
 
-  if(seq.size() % 2 != 0)
+void
+reverse_complement(const char* seq, size_t length, char* buffer)
+{
+  size_t i = 0;
+#if defined(__AVX2__)
+  for(; i + 32 <= length; i += 32)
   {
-    seq[swap_size] = complement[seq[swap_size]];
+    _mm256_storeu_si256(reinterpret_cast<__m256i*>(buffer + length - i - 32), reverse_complement_32(seq + i));
   }
+#endif
+#if defined(__SSSE3__)
+  for(; i + 16 <= length; i += 16)
+  {
+    _mm_storeu_si128(reinterpret_cast<__m128i*>(buffer + length - i - 16), reverse_complement_16(seq + i));
+  }
+#endif
+  for(; i < length; i++) { buffer[length - i - 1] = complement_char(seq[i]); }
+}
+
+void
+reverse_complement(view_type seq, std::string& output)
+{
+  output.resize(seq.second);
+  reverse_complement(seq.first, seq.second, &output[0]);
+}
+
+//------------------------------------------------------------------------------
+
+size_t
+advise_huge_pages(const void* data, size_t bytes)
+{
+#ifdef MADV_HUGEPAGE
+  size_t start = reinterpret_cast<size_t>(data);
+  size_t first = (start + HUGE_PAGE_SIZE - 1) & ~(HUGE_PAGE_SIZE - 1);
+  size_t last = (start + bytes) & ~(HUGE_PAGE_SIZE - 1);
+  if(data == nullptr || last <= first) { return 0; }
+  if(::madvise(reinterpret_cast<void*>(first), last - first, MADV_HUGEPAGE) != 0) { return 0; }
+  return last - first;
+#else
+  (void)data; (void)bytes;
+  return 0;
+#endif
 }
 
 //------------------------------------------------------------------------------
@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <set>
+#include <unordered_set>
 #include <utility>
 #include <vector>
 
@@ -53,6 +54,8 @@ TEST_F(GraphOperations, EmptyGraph)
 TEST_F(GraphOperations, CorrectNodes)
 {
   ASSERT_EQ(this->cached_graph.get_node_count(), this->graph.get_node_count()) << "Wrong number of nodes";
+  EXPECT_EQ(this->cached_graph.get_edge_count(), this->graph.get_edge_count()) << "Wrong number of edges";
+  EXPECT_EQ(this->cached_graph.get_total_length(), this->graph.get_total_length()) << "Wrong total length";
   EXPECT_EQ(this->cached_graph.min_node_id(), this->graph.min_node_id()) << "Wrong minimum node id";
   EXPECT_EQ(this->cached_graph.max_node_id(), this->graph.max_node_id()) << "Wrong maximum node id";
   for(nid_t id = this->cached_graph.min_node_id(); id <= this->cached_graph.max_node_id(); id++)
@@ -215,6 +218,227 @@ TEST_F(GraphOperations, ForEachHandle)
   ASSERT_EQ(found_handles, correct_handles) << "Parallel: Wrong handles in the graph";
 }
 
+TEST_F(GraphOperations, Prewarm)
+{
+  // All nodes in the graph with duplicates and nodes that do not exist.
+  std::vector<nid_t> nodes;
+  size_t existing = 0;
+  for(nid_t id = this->graph.min_node_id() - 1; id <= this->graph.max_node_id() + 1; id++)
+  {
+    nodes.push_back(id); nodes.push_back(id);
+    if(this->graph.has_node(id)) { existing++; }
+  }
+
+  // The second call visits the same nodes, even though the records are already cached.
+  CachedGBWTGraph prewarmed(this->graph);
+  EXPECT_EQ(prewarmed.prewarm(nodes), 2 * existing) << "Invalid number of visited orientations";
+  std::unordered_set<nid_t> node_set(nodes.begin(), nodes.end());
+  EXPECT_EQ(prewarmed.prewarm(node_set), 2 * existing) << "Invalid number of visited orientations from a set";
+
+  // Prewarmed caches for regions consisting of single nodes.
+  std::vector<std::vector<nid_t>> regions;
+  this->graph.for_each_handle([&](const handle_t& handle)
+  {
+    regions.push_back({ this->graph.get_id(handle) });
+  });
+  std::vector<CachedGBWTGraph> region_graphs = prewarmed_graphs(this->graph, regions);
+  ASSERT_EQ(region_graphs.size(), regions.size()) << "Invalid number of region graphs";
+
+  for(size_t i = 0; i < regions.size(); i++)
+  {
+    ASSERT_EQ(region_graphs[i].graph, &(this->graph)) << "Invalid graph for region " << i;
+    handle_t handle = this->graph.get_handle(regions[i].front(), false);
+    for(bool go_left : { false, true })
+    {
+      std::vector<handle_t> correct, found, found_region;
+      this->graph.follow_edges(handle, go_left, [&](const handle_t& next) { correct.push_back(next); });
+      prewarmed.follow_edges(handle, go_left, [&](const handle_t& next) { found.push_back(next); });
+      region_graphs[i].follow_edges(handle, go_left, [&](const handle_t& next) { found_region.push_back(next); });
+      EXPECT_EQ(found, correct) << "Invalid edges for node " << regions[i].front() << " with go_left = " << go_left;
+      EXPECT_EQ(found_region, correct) << "Invalid edges in region " << i << " with go_left = " << go_left;
+    }
+  }
+}
+
+//------------------------------------------------------------------------------
+
+class PathOperations : public ::testing::Test
+{
+public:
+  gbwt::GBWT index;
+  SequenceSource source;
+  GBWTGraph graph;
+  CachedGBWTGraph cached_graph;
+
+  std::vector<path_handle_t> paths;
+
+  void SetUp() override
+  {
+    this->index = build_gbwt_index_with_named_paths();
+    build_source(this->source);
+    this->graph = GBWTGraph(this->index, this->source);
+    this->cached_graph = CachedGBWTGraph(this->graph);
+
+    this->graph.for_each_path_handle([&](const path_handle_t& path_handle)
+    {
+      this->paths.push_back(path_handle);
+    });
+    this->graph.for_each_path_of_sense(PathSense::HAPLOTYPE, [&](const path_handle_t& path_handle)
+    {
+      this->paths.push_back(path_handle);
+    });
+  }
+};
+
+TEST_F(PathOperations, PathMetadata)
+{
+  ASSERT_EQ(this->cached_graph.get_path_count(), this->graph.get_path_count()) << "Wrong number of paths";
+  std::vector<path_handle_t> found_paths;
+  this->cached_graph.for_each_path_handle([&](const path_handle_t& path_handle)
+  {
+    found_paths.push_back(path_handle);
+  });
+  EXPECT_EQ(found_paths.size(), this->graph.get_path_count()) << "Wrong number of path handles";
+
+  for(const path_handle_t& path_handle : this->paths)
+  {
+    std::string name = this->graph.get_path_name(path_handle);
+    EXPECT_EQ(this->cached_graph.get_path_name(path_handle), name) << "Wrong path name";
+    if(this->graph.get_sense(path_handle) != PathSense::HAPLOTYPE)
+    {
+      EXPECT_TRUE(this->cached_graph.has_path(name)) << "Path " << name << " does not exist";
+      EXPECT_EQ(this->cached_graph.get_path_handle(name), path_handle) << "Wrong path handle for " << name;
+    }
+    EXPECT_EQ(this->cached_graph.get_sense(path_handle), this->graph.get_sense(path_handle)) << "Wrong sense for " << name;
+    EXPECT_EQ(this->cached_graph.get_sample_name(path_handle), this->graph.get_sample_name(path_handle)) << "Wrong sample name for " << name;
+    EXPECT_EQ(this->cached_graph.get_locus_name(path_handle), this->graph.get_locus_name(path_handle)) << "Wrong locus name for " << name;
+    EXPECT_EQ(this->cached_graph.get_step_count(path_handle), this->graph.get_step_count(path_handle)) << "Wrong step count for " << name;
+  }
+}
+
+TEST_F(PathOperations, PathsOfSense)
+{
+  std::unordered_set<std::string> samples;
+  for(PathSense sense : { PathSense::GENERIC, PathSense::REFERENCE, PathSense::HAPLOTYPE })
+  {
+    std::vector<path_handle_t> correct_paths, found_paths;
+    this->graph.for_each_path_of_sense(sense, [&](const path_handle_t& path_handle)
+    {
+      correct_paths.push_back(path_handle);
+      samples.insert(this->graph.get_sample_name(path_handle));
+    });
+    this->cached_graph.for_each_path_of_sense(sense, [&](const path_handle_t& path_handle)
+    {
+      found_paths.push_back(path_handle);
+    });
+    EXPECT_EQ(found_paths, correct_paths) << "Wrong paths of sense " << static_cast<int>(sense);
+  }
+  EXPECT_FALSE(this->paths.empty()) << "No paths in the graph";
+
+  for(const std::string& sample : samples)
+  {
+    std::unordered_set<std::string> query { sample };
+    std::vector<path_handle_t> correct_paths, found_paths;
+    this->graph.for_each_path_matching(nullptr, &query, nullptr, [&](const path_handle_t& path_handle)
+    {
+      correct_paths.push_back(path_handle);
+    });
+    this->cached_graph.for_each_path_matching(nullptr, &query, nullptr, [&](const path_handle_t& path_handle)
+    {
+      found_paths.push_back(path_handle);
+    });
+    EXPECT_FALSE(found_paths.empty()) << "No paths for sample " << sample;
+    EXPECT_EQ(found_paths, correct_paths) << "Wrong paths for sample " << sample;
+  }
+}
+
+TEST_F(PathOperations, PathSteps)
+{
+  for(const path_handle_t& path_handle : this->paths)
+  {
+    std::string name = this->graph.get_path_name(path_handle);
+    std::vector<step_handle_t> correct_steps;
+    for(step_handle_t step = this->graph.path_begin(path_handle); step != this->graph.path_end(path_handle); step = this->graph.get_next_step(step))
+    {
+      correct_steps.push_back(step);
+    }
+
+    // Forward.
+    std::vector<step_handle_t> found_steps;
+    step_handle_t step = this->cached_graph.path_begin(path_handle);
+    while(step != this->cached_graph.path_end(path_handle))
+    {
+      found_steps.push_back(step);
+      EXPECT_EQ(this->cached_graph.get_handle_of_step(step), this->graph.get_handle_of_step(step)) << "Wrong handle for a step on " << name;
+      EXPECT_EQ(this->cached_graph.get_path_handle_of_step(step), this->graph.get_path_handle_of_step(step)) << "Wrong path for a step on " << name;
+      bool has_next = this->cached_graph.has_next_step(step);
+      step = this->cached_graph.get_next_step(step);
+      EXPECT_EQ(has_next, step != this->cached_graph.path_end(path_handle)) << "Wrong has_next_step() on " << name;
+    }
+    EXPECT_EQ(found_steps, correct_steps) << "Wrong steps forward on " << name;
+
+    // Backward.
+    found_steps.clear();
+    step = this->cached_graph.path_back(path_handle);
+    while(step != this->cached_graph.path_front_end(path_handle))
+    {
+      found_steps.push_back(step);
+      bool has_previous = this->cached_graph.has_previous_step(step);
+      step = this->cached_graph.get_previous_step(step);
+      EXPECT_EQ(has_previous, step != this->cached_graph.path_front_end(path_handle)) << "Wrong has_previous_step() on " << name;
+    }
+    std::reverse(found_steps.begin(), found_steps.end());
+    EXPECT_EQ(found_steps, correct_steps) << "Wrong steps backward on " << name;
+  }
+}
+
+TEST_F(PathOperations, StepsOnHandle)
+{
+  this->graph.for_each_handle([&](const handle_t& handle)
+  {
+    for(handle_t oriented : { handle, this->graph.flip(handle) })
+    {
+      std::vector<step_handle_t> correct_steps, found_steps;
+      this->graph.for_each_step_on_handle(oriented, [&](const step_handle_t& step)
+      {
+        correct_steps.push_back(step);
+      });
+      this->cached_graph.for_each_step_on_handle(oriented, [&](const step_handle_t& step)
+      {
+        found_steps.push_back(step);
+      });
+      EXPECT_EQ(found_steps, correct_steps) << "Wrong steps on node " << this->graph.get_id(oriented);
+      EXPECT_EQ(this->cached_graph.get_step_count(oriented), this->graph.get_step_count(oriented)) << "Wrong step count on node " << this->graph.get_id(oriented);
+    }
+  });
+}
+
+TEST_F(PathOperations, StepsOfSense)
+{
+  size_t haplotype_steps = 0;
+  this->graph.for_each_handle([&](const handle_t& handle)
+  {
+    for(handle_t oriented : { handle, this->graph.flip(handle) })
+    {
+      for(PathSense sense : { PathSense::GENERIC, PathSense::REFERENCE, PathSense::HAPLOTYPE })
+      {
+        std::vector<step_handle_t> correct_steps, found_steps;
+        this->graph.for_each_step_of_sense(oriented, sense, [&](const step_handle_t& step)
+        {
+          correct_steps.push_back(step);
+        });
+        this->cached_graph.for_each_step_of_sense(oriented, sense, [&](const step_handle_t& step)
+        {
+          found_steps.push_back(step);
+        });
+        EXPECT_EQ(found_steps, correct_steps) << "Wrong steps of sense " << static_cast<int>(sense) << " on node " << this->graph.get_id(oriented);
+        if(sense == PathSense::HAPLOTYPE) { haplotype_steps += found_steps.size(); }
+      }
+    }
+  });
+  EXPECT_GT(haplotype_steps, size_t(0)) << "No haplotype steps in the cached graph";
+}
+
 //------------------------------------------------------------------------------
 
 } // namespace
@@ -1,6 +1,8 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
 #include <fstream>
+#include <limits>
 #include <set>
 #include <utility>
 #include <vector>
@@ -129,6 +131,8 @@ TEST_F(GraphOperations, EmptyGraph)
   SequenceSource empty_source;
   GBWTGraph empty_graph(empty_index, empty_source);
   EXPECT_EQ(empty_graph.get_node_count(), static_cast<size_t>(0)) << "Empty graph contains nodes";
+  EXPECT_EQ(empty_graph.get_edge_count(), static_cast<size_t>(0)) << "Empty graph contains edges";
+  EXPECT_EQ(empty_graph.get_total_length(), static_cast<size_t>(0)) << "Empty graph contains sequence";
   EXPECT_FALSE(empty_graph.has_segment_names()) << "Empty graph has segment names";
 }
 
@@ -553,6 +557,117 @@ TEST_F(GraphOperations, Edges)
   }
 }
 
+TEST_F(GraphOperations, EdgeIteration)
+{
+  for(bool parallel : { false, true })
+  {
+    std::vector<gbwt_edge> edges;
+    bool finished = this->graph.for_each_edge([&](const edge_t& edge)
+    {
+      gbwt_edge as_nodes(GBWTGraph::handle_to_node(edge.first), GBWTGraph::handle_to_node(edge.second));
+      #pragma omp critical
+      {
+        edges.push_back(as_nodes);
+      }
+    }, parallel);
+    EXPECT_TRUE(finished) << "Edge iteration stopped early with parallel = " << parallel;
+    EXPECT_EQ(edges.size(), this->correct_edges.size()) << "Invalid number of edges with parallel = " << parallel;
+    std::set<gbwt_edge> edge_set(edges.begin(), edges.end());
+    EXPECT_EQ(edge_set, this->correct_edges) << "Invalid edges with parallel = " << parallel;
+    for(const gbwt_edge& edge : edges)
+    {
+      edge_t as_handles(GBWTGraph::node_to_handle(edge.first), GBWTGraph::node_to_handle(edge.second));
+      EXPECT_EQ(this->graph.edge_handle(as_handles.first, as_handles.second), as_handles) << "Edge is not in the canonical orientation with parallel = " << parallel;
+    }
+  }
+
+  size_t visited = 0;
+  bool finished = this->graph.for_each_edge([&](const edge_t&) -> bool
+  {
+    visited++;
+    return false;
+  });
+  EXPECT_FALSE(finished) << "Edge iteration did not report stopping early";
+  EXPECT_EQ(visited, size_t(1)) << "Edge iteration did not stop after the first edge";
+}
+
+TEST_F(GraphOperations, WalkLabels)
+{
+  // Both orientations of the paths.
+  std::vector<std::vector<handle_t>> walks;
+  for(const gbwt::vector_type& path : this->correct_paths)
+  {
+    std::vector<handle_t> forward, reverse;
+    for(gbwt::node_type node : path) { forward.push_back(GBWTGraph::node_to_handle(node)); }
+    for(auto iter = path.rbegin(); iter != path.rend(); ++iter) { reverse.push_back(GBWTGraph::node_to_handle(gbwt::Node::reverse(*iter))); }
+    walks.push_back(forward); walks.push_back(reverse);
+  }
+  walks.push_back({ });
+
+  std::vector<std::pair<size_t, size_t>> bounds;
+  std::vector<std::string> truth;
+  for(const std::vector<handle_t>& walk : walks)
+  {
+    std::string full;
+    for(handle_t handle : walk) { full += this->graph.get_sequence(handle); }
+    size_t first_length = (walk.empty() ? 0 : this->graph.get_length(walk.front()));
+    for(size_t offset : { size_t(0), size_t(1), first_length + 1 })
+    {
+      for(size_t length : { size_t(0), size_t(2), full.length(), std::numeric_limits<size_t>::max() })
+      {
+        std::string expected = full.substr(std::min(offset, first_length), length);
+        EXPECT_EQ(this->graph.label_length(walk, offset, length), expected.length()) << "Invalid label length with offset " << offset << ", length " << length;
+        std::string buffer(expected.length(), 'N');
+        size_t written = this->graph.write_label(walk, &buffer[0], offset, length);
+        EXPECT_EQ(written, expected.length()) << "Invalid number of bases written with offset " << offset << ", length " << length;
+        EXPECT_EQ(buffer, expected) << "Invalid label with offset " << offset << ", length " << length;
+        bounds.emplace_back(offset, length);
+        truth.push_back(expected);
+      }
+    }
+  }
+
+  std::vector<std::vector<handle_t>> batch;
+  for(const std::vector<handle_t>& walk : walks)
+  {
+    for(size_t i = 0; i < truth.size() / walks.size(); i++) { batch.push_back(walk); }
+  }
+  for(bool parallel : { false, true })
+  {
+    std::string arena;
+    std::vector<size_t> starts = this->graph.write_labels(batch, bounds, arena, parallel);
+    ASSERT_EQ(starts.size(), batch.size() + 1) << "Invalid number of label starts with parallel = " << parallel;
+    EXPECT_EQ(starts.back(), arena.length()) << "Invalid arena length with parallel = " << parallel;
+    for(size_t i = 0; i < batch.size(); i++)
+    {
+      EXPECT_EQ(arena.substr(starts[i], starts[i + 1] - starts[i]), truth[i]) << "Invalid label " << i << " in the arena with parallel = " << parallel;
+    }
+  }
+}
+
+TEST_F(GraphOperations, Statistics)
+{
+  size_t edges = 0;
+  this->graph.for_each_edge([&](const edge_t&)
+  {
+    edges++;
+  });
+  EXPECT_EQ(this->graph.get_edge_count(), this->correct_edges.size()) << "Wrong number of edges";
+  EXPECT_EQ(this->graph.get_edge_count(), edges) << "Edge count does not match for_each_edge()";
+
+  size_t total_length = 0, min_length = std::numeric_limits<size_t>::max(), max_length = 0;
+  for(nid_t id : this->correct_nodes)
+  {
+    size_t length = this->source.get_length(id);
+    total_length += length;
+    min_length = std::min(min_length, length);
+    max_length = std::max(max_length, length);
+  }
+  EXPECT_EQ(this->graph.get_total_length(), total_length) << "Wrong total length";
+  EXPECT_EQ(this->graph.min_node_length(), min_length) << "Wrong minimum node length";
+  EXPECT_EQ(this->graph.max_node_length(), max_length) << "Wrong maximum node length";
+}
+
 TEST_F(GraphOperations, ForEachHandle)
 {
   std::vector<handle_t> found_handles;
@@ -683,6 +798,145 @@ TEST_F(GraphOperations, BidirectionalTraversal)
   }
 }
 
+TEST_F(GraphOperations, TemplateInterface)
+{
+  gbwt::CachedGBWT cache = this->graph.get_cache();
+  std::vector<handle_t> nodes, expected_nodes;
+  this->graph.for_each_node([&](const handle_t& handle) -> bool
+  {
+    nodes.push_back(handle);
+    return true;
+  });
+  this->graph.for_each_handle([&](const handle_t& handle)
+  {
+    expected_nodes.push_back(handle);
+  });
+  ASSERT_EQ(nodes, expected_nodes) << "Invalid nodes from the template interface";
+
+  for(handle_t node : nodes)
+  {
+    for(handle_t handle : { node, this->graph.flip(node) })
+    {
+      for(bool go_left : { false, true })
+      {
+        std::vector<handle_t> found, expected;
+        this->graph.for_each_successor(cache, handle, go_left, [&](const handle_t& next) -> bool
+        {
+          found.push_back(next);
+          return true;
+        });
+        this->graph.follow_edges(handle, go_left, [&](const handle_t& next)
+        {
+          expected.push_back(next);
+        });
+        EXPECT_EQ(found, expected) << "Invalid edges from node " << this->graph.get_id(handle) << " with go_left = " << go_left;
+      }
+
+      std::vector<gbwt::node_type> found_next, expected_next;
+      this->graph.for_each_extension(cache, this->graph.get_state(cache, handle), [&](const gbwt::SearchState& next) -> bool
+      {
+        found_next.push_back(next.node);
+        return true;
+      });
+      this->graph.follow_paths(this->graph.get_state(handle), [&](const gbwt::SearchState& next) -> bool
+      {
+        expected_next.push_back(next.node);
+        return true;
+      });
+      EXPECT_EQ(found_next, expected_next) << "Invalid extensions from node " << this->graph.get_id(handle);
+
+      for(bool backward : { false, true })
+      {
+        std::vector<gbwt::size_type> found_sizes, expected_sizes;
+        this->graph.for_each_extension(cache, this->graph.get_bd_state(cache, handle), backward, [&](const gbwt::BidirectionalState& next) -> bool
+        {
+          found_sizes.push_back(next.size());
+          return true;
+        });
+        this->graph.follow_paths(this->graph.get_bd_state(handle), backward, [&](const gbwt::BidirectionalState& next) -> bool
+        {
+          expected_sizes.push_back(next.size());
+          return true;
+        });
+        EXPECT_EQ(found_sizes, expected_sizes) << "Invalid bidirectional extensions from node " << this->graph.get_id(handle) << " with backward = " << backward;
+      }
+    }
+  }
+
+  // Early termination.
+  size_t count = 0;
+  bool finished = this->graph.for_each_node([&](const handle_t&) -> bool
+  {
+    count++;
+    return false;
+  });
+  EXPECT_FALSE(finished) << "The iteration did not stop early";
+  EXPECT_EQ(count, size_t(1)) << "The iteration did not stop after the first node";
+}
+
+TEST_F(GraphOperations, NodeRecords)
+{
+  GBWTGraph with_records = this->graph;
+  ASSERT_FALSE(with_records.has_node_records()) << "The graph has node records by default";
+  ASSERT_TRUE(with_records.build_node_records()) << "Could not build node records";
+  ASSERT_TRUE(with_records.has_node_records()) << "The graph does not have node records";
+
+  for(nid_t id = this->graph.min_node_id() - 1; id <= this->graph.max_node_id() + 1; id++)
+  {
+    EXPECT_EQ(with_records.has_node(id), this->graph.has_node(id)) << "Invalid existence for node " << id;
+    if(!(this->graph.has_node(id))) { continue; }
+    for(bool is_reverse : { false, true })
+    {
+      handle_t handle = this->graph.get_handle(id, is_reverse);
+      EXPECT_EQ(with_records.get_length(handle), this->graph.get_length(handle)) << "Invalid length for node " << id;
+      EXPECT_EQ(with_records.get_sequence(handle), this->graph.get_sequence(handle)) << "Invalid sequence for node " << id;
+      auto view = with_records.get_sequence_view(handle);
+      EXPECT_EQ(std::string(view.first, view.second), this->graph.get_sequence(handle)) << "Invalid sequence view for node " << id;
+      EXPECT_EQ(with_records.get_subsequence(handle, 1, 2), this->graph.get_subsequence(handle, 1, 2)) << "Invalid subsequence for node " << id;
+      EXPECT_EQ(with_records.get_base(handle, 0), this->graph.get_base(handle, 0)) << "Invalid base for node " << id;
+      for(bool go_left : { false, true })
+      {
+        EXPECT_EQ(with_records.get_degree(handle, go_left), this->graph.get_degree(handle, go_left)) << "Invalid degree for node " << id << " with go_left = " << go_left;
+      }
+    }
+  }
+
+  with_records.set_gbwt(this->index);
+  EXPECT_FALSE(with_records.has_node_records()) << "Node records were not cleared when the GBWT was set";
+}
+
+TEST_F(GraphOperations, DeduplicatedSequences)
+{
+  std::set<std::string> distinct;
+  for(size_t offset = 0; offset < this->graph.sequences.size(); offset++) { distinct.insert(this->graph.sequences.str(offset)); }
+
+  for(bool with_records : { false, true })
+  {
+    GBWTGraph deduplicated = this->graph;
+    if(with_records) { deduplicated.build_node_records(); }
+    ASSERT_FALSE(deduplicated.has_deduplicated_sequences()) << "The graph has deduplicated sequences by default";
+    EXPECT_EQ(deduplicated.deduplicate_sequences(), distinct.size()) << "Invalid number of distinct sequences";
+    ASSERT_TRUE(deduplicated.has_deduplicated_sequences()) << "The graph does not have deduplicated sequences";
+    EXPECT_EQ(deduplicated.sequences.size(), size_t(0)) << "The original sequences were not cleared";
+    EXPECT_EQ(deduplicated.has_node_records(), with_records) << "Node records were not rebuilt";
+    EXPECT_EQ(deduplicated.statistics, this->graph.statistics) << "Deduplication changed the statistics";
+
+    for(nid_t id = this->graph.min_node_id(); id <= this->graph.max_node_id(); id++)
+    {
+      if(!(this->graph.has_node(id))) { continue; }
+      for(bool is_reverse : { false, true })
+      {
+        handle_t handle = this->graph.get_handle(id, is_reverse);
+        EXPECT_EQ(deduplicated.get_length(handle), this->graph.get_length(handle)) << "Invalid length for node " << id;
+        EXPECT_EQ(deduplicated.get_sequence(handle), this->graph.get_sequence(handle)) << "Invalid sequence for node " << id;
+        auto view = deduplicated.get_sequence_view(handle);
+        EXPECT_EQ(std::string(view.first, view.second), this->graph.get_sequence(handle)) << "Invalid sequence view for node " << id;
+        EXPECT_EQ(deduplicated.get_base(handle, 0), this->graph.get_base(handle, 0)) << "Invalid base for node " << id;
+      }
+    }
+  }
+}
+
 //------------------------------------------------------------------------------
 
 class GraphSerialization : public ::testing::Test
@@ -708,6 +962,7 @@ public:
     ASSERT_EQ(graph.header, truth.header) << "Serialization did not preserve the header";
     ASSERT_EQ(graph.sequences, truth.sequences) << "Serialization did not preserve the sequences";
     ASSERT_EQ(graph.real_nodes, truth.real_nodes) << "Serialization did not preserve the real nodes";
+    ASSERT_EQ(graph.statistics, truth.statistics) << "Serialization did not preserve the statistics";
     ASSERT_EQ(graph.segments, truth.segments) << "Serialization did not preserve the segments";
     ASSERT_EQ(graph.node_to_segment, truth.node_to_segment) << "Serialization did not preserve the node-to-segment mapping";
   }
@@ -759,6 +1014,29 @@ TEST_F(GraphSerialization, SerializeNonEmpty)
   gbwt::TempFile::remove(filename);
 }
 
+TEST_F(GraphSerialization, SetGBWTBeforeLoading)
+{
+  std::string filename = gbwt::TempFile::getName("gbwtgraph");
+  this->graph.serialize(filename);
+  std::string empty_filename = gbwt::TempFile::getName("gbwtgraph");
+  GBWTGraph().serialize(empty_filename);
+
+  // The statistics must be computed when the GBWT is set before loading the graph.
+  GBWTGraph duplicate_graph;
+  duplicate_graph.set_gbwt(this->index);
+  duplicate_graph.deserialize(filename);
+  this->check_graph(duplicate_graph, this->graph);
+
+  // Statistics from the previous graph must not survive loading another graph.
+  gbwt::GBWT empty_gbwt;
+  duplicate_graph.set_gbwt(empty_gbwt);
+  duplicate_graph.deserialize(empty_filename);
+  EXPECT_EQ(duplicate_graph.statistics, GBWTGraph::Statistics()) << "Stale statistics after loading another graph";
+
+  gbwt::TempFile::remove(filename);
+  gbwt::TempFile::remove(empty_filename);
+}
+
 TEST_F(GraphSerialization, CompressNonEmpty)
 {
   size_t expected_size = this->graph.simple_sds_size() * sizeof(sdsl::simple_sds::element_type);
@@ -834,6 +1112,38 @@ TEST_F(GraphSerialization, DecompressSerialized)
   gbwt::TempFile::remove(filename);
 }
 
+TEST_F(GraphSerialization, SerializeDeduplicated)
+{
+  GBWTGraph deduplicated = this->graph;
+  deduplicated.deduplicate_sequences();
+
+  // SDSL format.
+  {
+    std::string filename = gbwt::TempFile::getName("gbwtgraph");
+    deduplicated.serialize(filename);
+    GBWTGraph duplicate_graph;
+    duplicate_graph.deserialize(filename);
+    duplicate_graph.set_gbwt(this->index);
+    this->check_graph(duplicate_graph, this->graph);
+    gbwt::TempFile::remove(filename);
+  }
+
+  // Simple-sds format.
+  {
+    size_t expected_size = this->graph.simple_sds_size() * sizeof(sdsl::simple_sds::element_type);
+    EXPECT_EQ(deduplicated.simple_sds_size() * sizeof(sdsl::simple_sds::element_type), expected_size) << "Invalid serialized size";
+    std::string filename = gbwt::TempFile::getName("gbwtgraph");
+    sdsl::simple_sds::serialize_to(deduplicated, filename);
+    GBWTGraph duplicate_graph;
+    std::ifstream in(filename, std::ios_base::binary);
+    duplicate_graph.simple_sds_load(in, this->index);
+    in.close();
+    this->check_graph(duplicate_graph, this->graph);
+    EXPECT_FALSE(duplicate_graph.has_deduplicated_sequences()) << "The loaded graph has deduplicated sequences";
+    gbwt::TempFile::remove(filename);
+  }
+}
+
 //------------------------------------------------------------------------------
 
 class ForEachWindow : public ::testing::Test
@@ -147,6 +147,27 @@ TEST_F(GBZSerialization, SwapAndSerialize)
   gbwt::TempFile::remove(filename);
 }
 
+TEST_F(GBZSerialization, SeparateFiles)
+{
+  std::unique_ptr<GBZ> original = this->create_gbz();
+  for(bool simple_sds_graph : { false, true })
+  {
+    std::string gbwt_name = gbwt::TempFile::getName("gbwt");
+    std::string graph_name = gbwt::TempFile::getName("graph");
+    original->serialize_to_files(gbwt_name, graph_name, simple_sds_graph);
+
+    GBZ loaded;
+    loaded.load_from_files(gbwt_name, graph_name);
+    std::string format = (simple_sds_graph ? "simple-sds" : "libhandlegraph");
+    ASSERT_EQ(loaded.graph.index, &(loaded.index)) << "Graph does not use the GBWT with " << format << " graph";
+    this->check_gbz(loaded, *original);
+    EXPECT_EQ(loaded.graph.statistics, original->graph.statistics) << "Invalid statistics with " << format << " graph";
+
+    gbwt::TempFile::remove(gbwt_name);
+    gbwt::TempFile::remove(graph_name);
+  }
+}
+
 //------------------------------------------------------------------------------
 
 } // namespace
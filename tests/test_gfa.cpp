@@ -1,5 +1,9 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+#include <fstream>
+#include <map>
+
 #include <gbwtgraph/gbwtgraph.h>
 #include <gbwtgraph/gfa.h>
 
@@ -368,6 +372,88 @@ TEST_F(GFAConstruction, SegmentChopping)
   this->check_links(graph, links);
 }
 
+TEST_F(GFAConstruction, TranslationTable)
+{
+  GFAParsingParameters parameters;
+  parameters.max_node_length = 3;
+  auto gfa_parse = gfa_to_gbwt("gfas/example_chopping.gfa", parameters);
+  GBWTGraph graph(*(gfa_parse.first), *(gfa_parse.second));
+
+  // Segment 3 is not used on any path, so it is not in the table.
+  std::vector<translation_type> translation =
+  {
+    { "1", { 1, 2 } },
+    { "2", { 2, 3 } },
+    { "4", { 4, 6 } },
+    { "6", { 6, 7 } },
+    { "7", { 7, 8 } },
+    { "8", { 8, 9 } },
+    { "9", { 9, 10 } },
+  };
+  std::vector<std::string> correct_rows =
+  {
+    "T\t1\t1", "T\t2\t2", "T\t4\t4,5", "T\t6\t6", "T\t7\t7", "T\t8\t8", "T\t9\t9"
+  };
+
+  for(size_t threads : { 1, 2, 4 })
+  {
+    std::string filename = gbwt::TempFile::getName("translation");
+    std::ofstream out(filename, std::ios_base::binary);
+    GFAExtractionParameters extraction_parameters;
+    extraction_parameters.num_threads = threads;
+    write_translation(graph, out, extraction_parameters);
+    out.close();
+
+    std::vector<std::string> rows;
+    gbwt::readRows(filename, rows, false);
+    EXPECT_EQ(rows, correct_rows) << "Invalid translation table with " << threads << " threads";
+
+    SequenceSource source;
+    load_translation(filename, source);
+    EXPECT_EQ(source.segment_translation.size(), translation.size()) << "Invalid number of segments with " << threads << " threads";
+    this->check_translation(source, translation);
+
+    GBWTGraph copy(graph);
+    load_translation(filename, copy);
+    EXPECT_EQ(copy.segments, graph.segments) << "Invalid segment names with " << threads << " threads";
+    EXPECT_EQ(copy.node_to_segment, graph.node_to_segment) << "Invalid node-to-segment mapping with " << threads << " threads";
+    this->check_translation(copy, translation);
+
+    gbwt::TempFile::remove(filename);
+  }
+}
+
+TEST_F(GFAConstruction, UncoveredNodes)
+{
+  GFAParsingParameters parameters;
+  parameters.max_node_length = 3;
+  auto gfa_parse = gfa_to_gbwt("gfas/example_chopping.gfa", parameters);
+  GBWTGraph graph(*(gfa_parse.first), *(gfa_parse.second));
+
+  // Each table leaves a node in the graph uncovered: before the first row,
+  // between two rows, and after the last row.
+  std::vector<std::string> tables =
+  {
+    "T\t2\t2\nT\t4\t4,5\nT\t6\t6\nT\t7\t7\nT\t8\t8\nT\t9\t9\n",
+    "T\t1\t1\nT\t2\t2\nT\t4\t4,5\nT\t6\t6\nT\t8\t8\nT\t9\t9\n",
+    "T\t1\t1\nT\t2\t2\nT\t4\t4,5\nT\t6\t6\nT\t7\t7\nT\t8\t8\n",
+  };
+  for(size_t i = 0; i < tables.size(); i++)
+  {
+    std::string filename = gbwt::TempFile::getName("translation");
+    std::ofstream out(filename, std::ios_base::binary);
+    out << tables[i];
+    out.close();
+
+    GBWTGraph copy(graph);
+    EXPECT_THROW(load_translation(filename, copy), std::runtime_error) << "Table " << i << " was accepted with an uncovered node";
+    EXPECT_EQ(copy.segments, graph.segments) << "Table " << i << " changed the segment names";
+    EXPECT_EQ(copy.node_to_segment, graph.node_to_segment) << "Table " << i << " changed the node-to-segment mapping";
+
+    gbwt::TempFile::remove(filename);
+  }
+}
+
 class GFAConstructionReversal : public GFAConstruction
 {
 public:
@@ -618,6 +704,293 @@ TEST_F(GFAExtraction, PathModes)
 
 //------------------------------------------------------------------------------
 
+class FASTAExtraction : public ::testing::Test
+{
+public:
+  typedef std::pair<std::string, std::string> record_type; // (name, sequence)
+
+  // Returns the records for the paths selected by the parameters in path id order.
+  std::vector<record_type> expected_records(const GBWTGraph& graph, const FASTAExtractionParameters& parameters) const
+  {
+    std::vector<record_type> result;
+    const gbwt::GBWT& index = *(graph.index);
+    for(gbwt::size_type path_id = 0; path_id < index.metadata.paths(); path_id++)
+    {
+      const gbwt::PathName& path_name = index.metadata.path(path_id);
+      std::string sample = index.metadata.sample(path_name.sample);
+      std::string contig = index.metadata.contig(path_name.contig);
+      if(!(parameters.samples.empty()) && parameters.samples.find(sample) == parameters.samples.end()) { continue; }
+      if(!(parameters.contigs.empty()) && parameters.contigs.find(contig) == parameters.contigs.end()) { continue; }
+      PathSense sense = get_path_sense(index, path_id, graph.reference_samples);
+      std::string sequence;
+      for(gbwt::node_type node : index.extract(gbwt::Path::encode(path_id, false)))
+      {
+        sequence += graph.get_sequence(GBWTGraph::node_to_handle(node));
+      }
+      result.emplace_back(compose_path_name(index, path_id, sense), sequence);
+    }
+    return result;
+  }
+
+  // Extracts the FASTA and parses the records, checking the line lengths.
+  std::vector<record_type> extract_records(const GBWTGraph& graph, const FASTAExtractionParameters& parameters) const
+  {
+    std::string filename = gbwt::TempFile::getName("fasta-extraction");
+    std::ofstream out(filename, std::ios_base::binary);
+    gbwt_to_fasta(graph, out, parameters);
+    out.close();
+
+    std::vector<std::string> rows;
+    gbwt::readRows(filename, rows, false);
+    gbwt::TempFile::remove(filename);
+
+    std::vector<record_type> result;
+    for(const std::string& row : rows)
+    {
+      if(!(row.empty()) && row.front() == '>')
+      {
+        result.emplace_back(row.substr(1), "");
+        continue;
+      }
+      if(result.empty()) { ADD_FAILURE() << "Sequence line before the first header"; break; }
+      if(parameters.line_length > 0)
+      {
+        EXPECT_LE(row.length(), parameters.line_length) << "Sequence line too long in " << result.back().first;
+      }
+      result.back().second += row;
+    }
+    return result;
+  }
+};
+
+TEST_F(FASTAExtraction, AllPaths)
+{
+  auto gfa_parse = gfa_to_gbwt("gfas/example_walks.gfa");
+  GBWTGraph graph(*(gfa_parse.first), *(gfa_parse.second));
+
+  for(size_t threads : { 1, 2, 4 })
+  {
+    for(size_t line_length : { size_t(0), size_t(4), FASTAExtractionParameters::LINE_LENGTH })
+    {
+      FASTAExtractionParameters parameters;
+      parameters.num_threads = threads;
+      parameters.line_length = line_length;
+      std::vector<record_type> expected = this->expected_records(graph, parameters);
+      std::vector<record_type> records = this->extract_records(graph, parameters);
+      EXPECT_EQ(records, expected) << "Invalid records with " << threads << " threads and line length " << line_length;
+    }
+  }
+}
+
+TEST_F(FASTAExtraction, Unordered)
+{
+  auto gfa_parse = gfa_to_gbwt("gfas/example_walks.gfa");
+  GBWTGraph graph(*(gfa_parse.first), *(gfa_parse.second));
+
+  FASTAExtractionParameters parameters;
+  parameters.num_threads = 2;
+  parameters.ordered = false;
+  std::vector<record_type> expected = this->expected_records(graph, parameters);
+  std::vector<record_type> records = this->extract_records(graph, parameters);
+  std::sort(expected.begin(), expected.end());
+  std::sort(records.begin(), records.end());
+  EXPECT_EQ(records, expected) << "Invalid records with unordered output";
+}
+
+TEST_F(FASTAExtraction, Selection)
+{
+  auto gfa_parse = gfa_to_gbwt("gfas/example_walks.gfa");
+  GBWTGraph graph(*(gfa_parse.first), *(gfa_parse.second));
+
+  {
+    FASTAExtractionParameters parameters;
+    parameters.samples = { "short" };
+    std::vector<record_type> expected = this->expected_records(graph, parameters);
+    ASSERT_EQ(expected.size(), size_t(2)) << "Invalid number of paths for sample short";
+    EXPECT_EQ(this->extract_records(graph, parameters), expected) << "Invalid records for sample short";
+  }
+
+  {
+    FASTAExtractionParameters parameters;
+    parameters.contigs = { "alt1", "alt2" };
+    std::vector<record_type> expected = this->expected_records(graph, parameters);
+    ASSERT_EQ(expected.size(), size_t(2)) << "Invalid number of paths for contigs alt1 and alt2";
+    EXPECT_EQ(this->extract_records(graph, parameters), expected) << "Invalid records for contigs alt1 and alt2";
+  }
+
+  {
+    FASTAExtractionParameters parameters;
+    parameters.samples = { "nonexistent" };
+    EXPECT_TRUE(this->extract_records(graph, parameters).empty()) << "Found paths for a nonexistent sample";
+  }
+}
+
+//------------------------------------------------------------------------------
+
+class NodeRenumbering : public ::testing::Test
+{
+public:
+  // Path name -> path sequence.
+  std::map<std::string, std::string> path_sequences(const GBWTGraph& graph) const
+  {
+    std::map<std::string, std::string> result;
+    const gbwt::GBWT& index = *(graph.index);
+    for(gbwt::size_type path_id = 0; path_id < index.metadata.paths(); path_id++)
+    {
+      PathSense sense = get_path_sense(index, path_id, graph.reference_samples);
+      std::string sequence;
+      for(gbwt::node_type node : index.extract(gbwt::Path::encode(path_id, false)))
+      {
+        sequence += graph.get_sequence(GBWTGraph::node_to_handle(node));
+      }
+      result[compose_path_name(index, path_id, sense)] = sequence;
+    }
+    return result;
+  }
+
+  // Segment name -> segment sequence.
+  std::map<std::string, std::string> segment_sequences(const GBWTGraph& graph) const
+  {
+    std::map<std::string, std::string> result;
+    if(!(graph.has_segment_names()))
+    {
+      graph.for_each_handle([&](const handle_t& handle)
+      {
+        result[std::to_string(graph.get_id(handle))] = graph.get_sequence(handle);
+      });
+      return result;
+    }
+    graph.for_each_segment([&](const std::string& name, std::pair<nid_t, nid_t> nodes)
+    {
+      std::string sequence;
+      for(nid_t id = nodes.first; id < nodes.second; id++) { sequence += graph.get_sequence(graph.get_handle(id, false)); }
+      result[name] = sequence;
+    });
+    return result;
+  }
+
+  void check_renumbering(const std::string& filename) const
+  {
+    auto original_parse = gfa_to_gbwt(filename);
+    GBWTGraph original(*(original_parse.first), *(original_parse.second));
+
+    GFAParsingParameters parameters;
+    parameters.renumber_nodes = true;
+    auto renumbered_parse = gfa_to_gbwt(filename, parameters);
+    ASSERT_TRUE(renumbered_parse.second->uses_translation()) << "No translation after renumbering " << filename;
+    GBWTGraph renumbered(*(renumbered_parse.first), *(renumbered_parse.second));
+
+    EXPECT_EQ(renumbered.get_node_count(), original.get_node_count()) << "Invalid number of nodes in " << filename;
+    EXPECT_EQ(renumbered.get_edge_count(), original.get_edge_count()) << "Invalid number of edges in " << filename;
+    EXPECT_EQ(this->segment_sequences(renumbered), this->segment_sequences(original)) << "Invalid segments in " << filename;
+    EXPECT_EQ(this->path_sequences(renumbered), this->path_sequences(original)) << "Invalid paths in " << filename;
+  }
+};
+
+TEST_F(NodeRenumbering, SameGraph)
+{
+  std::vector<std::string> filenames
+  {
+    "gfas/example.gfa", "gfas/components_walks.gfa", "gfas/cyclic.gfa", "gfas/reversal.gfa", "gfas/example_str-names.gfa"
+  };
+  for(const std::string& filename : filenames)
+  {
+    this->check_renumbering(filename);
+  }
+}
+
+TEST_F(NodeRenumbering, TopologicalOrder)
+{
+  GFAParsingParameters parameters;
+  parameters.renumber_nodes = true;
+  auto gfa_parse = gfa_to_gbwt("gfas/components_walks.gfa", parameters);
+  GBWTGraph graph(*(gfa_parse.first), *(gfa_parse.second));
+
+  // Both components are acyclic, so edges between forward orientations must go
+  // from smaller to larger node ids.
+  graph.for_each_edge([&](const edge_t& edge)
+  {
+    if(graph.get_is_reverse(edge.first) || graph.get_is_reverse(edge.second)) { return; }
+    EXPECT_LT(graph.get_id(edge.first), graph.get_id(edge.second)) << "Edge from " << graph.get_segment_name(edge.first) << " to " << graph.get_segment_name(edge.second) << " goes backward";
+  });
+
+  // Components get consecutive node ids, starting from their source nodes.
+  EXPECT_EQ(gfa_parse.second->get_translation("11").first, nid_t(1)) << "The first component does not start from its source";
+  EXPECT_EQ(gfa_parse.second->get_translation("21").first, nid_t(8)) << "The second component does not start after the first";
+}
+
+// Uses the same path and segment comparisons as node renumbering.
+class ChainUnchopping : public NodeRenumbering
+{
+public:
+  void check_unchopping(const std::string& filename, size_t expected_nodes) const
+  {
+    auto original_parse = gfa_to_gbwt(filename);
+    GBWTGraph original(*(original_parse.first), *(original_parse.second));
+
+    GFAParsingParameters parameters;
+    parameters.unchop_chains = true;
+    auto unchopped_parse = gfa_to_gbwt(filename, parameters);
+    GBWTGraph unchopped(*(unchopped_parse.first), *(unchopped_parse.second));
+
+    EXPECT_EQ(unchopped.get_node_count(), expected_nodes) << "Invalid number of nodes in " << filename;
+    EXPECT_EQ(unchopped.statistics.total_length, original.statistics.total_length) << "Invalid total length in " << filename;
+    EXPECT_EQ(this->path_sequences(unchopped), this->path_sequences(original)) << "Invalid paths in " << filename;
+  }
+};
+
+TEST_F(ChainUnchopping, SamePaths)
+{
+  this->check_unchopping("gfas/example.gfa", 7);
+  this->check_unchopping("gfas/components_walks.gfa", 11);
+  this->check_unchopping("gfas/reversal.gfa", 2);
+}
+
+TEST_F(ChainUnchopping, MergedNodes)
+{
+  GFAParsingParameters parameters;
+  parameters.unchop_chains = true;
+  auto gfa_parse = gfa_to_gbwt("gfas/example.gfa", parameters);
+  GBWTGraph graph(*(gfa_parse.first), *(gfa_parse.second));
+
+  // Nodes 4, 5, and 6 form a chain.
+  ASSERT_TRUE(graph.has_node(4)) << "The merged node is missing";
+  EXPECT_EQ(graph.get_sequence(graph.get_handle(4, false)), "GGGTA") << "Invalid sequence for the merged node";
+  EXPECT_FALSE(graph.has_node(5)) << "Node 5 was not merged";
+  EXPECT_FALSE(graph.has_node(6)) << "Node 6 was not merged";
+}
+
+TEST_F(ChainUnchopping, MaxNodeLength)
+{
+  GFAParsingParameters parameters;
+  parameters.unchop_chains = true;
+  parameters.max_node_length = 4;
+  auto gfa_parse = gfa_to_gbwt("gfas/example.gfa", parameters);
+  GBWTGraph graph(*(gfa_parse.first), *(gfa_parse.second));
+
+  // Only nodes 4 and 5 fit into a 4 bp node.
+  EXPECT_EQ(graph.get_node_count(), size_t(8)) << "Invalid number of nodes";
+  EXPECT_EQ(graph.statistics.max_length, size_t(4)) << "Invalid maximum node length";
+  ASSERT_TRUE(graph.has_node(4)) << "The merged node is missing";
+  EXPECT_EQ(graph.get_sequence(graph.get_handle(4, false)), "GGGT") << "Invalid sequence for the merged node";
+  EXPECT_FALSE(graph.has_node(5)) << "Node 5 was not merged";
+  EXPECT_TRUE(graph.has_node(6)) << "Node 6 was merged";
+}
+
+TEST_F(ChainUnchopping, RequiresNoTranslation)
+{
+  GFAParsingParameters parameters;
+  parameters.unchop_chains = true;
+  EXPECT_THROW(gfa_to_gbwt("gfas/example_str-names.gfa", parameters), std::runtime_error) << "Unchopped a graph with string segment names";
+  parameters.max_node_length = 2;
+  EXPECT_THROW(gfa_to_gbwt("gfas/example.gfa", parameters), std::runtime_error) << "Unchopped a chopped graph";
+  parameters.max_node_length = GFAParsingParameters().max_node_length;
+  parameters.renumber_nodes = true;
+  EXPECT_THROW(gfa_to_gbwt("gfas/example.gfa", parameters), std::runtime_error) << "Unchopped a renumbered graph";
+}
+
+//------------------------------------------------------------------------------
+
 class GBWTMetadata : public ::testing::Test
 {
 public:
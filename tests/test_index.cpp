@@ -102,6 +102,141 @@ TEST_F(IndexConstruction, DefaultMinimizerIndex)
   this->check_minimizer_index(correct_values);
 }
 
+TEST_F(IndexConstruction, HaplotypeCounts)
+{
+  // Determine the correct minimizer occurrences.
+  std::map<DefaultMinimizerIndex::key_type, std::set<std::pair<pos_t, payload_type>>> correct_values;
+  this->insert_values(alt_path, correct_values);
+  this->insert_values(short_path, correct_values);
+
+  // Index the haplotypes with haplotype counts.
+  index_haplotypes(this->graph, this->mi, [](const pos_t& pos) -> payload_type
+  {
+    return payload_type::create(hash(pos));
+  }, true);
+  ASSERT_TRUE(this->mi.uses_haplotype_counts()) << "The index does not use haplotype counts";
+  ASSERT_EQ(this->mi.size(), correct_values.size()) << "Wrong number of keys";
+
+  // There are three haplotypes, and nodes 2 and 8 are only visited by one of them.
+  size_t max_haplotypes = 3;
+  for(auto iter = correct_values.begin(); iter != correct_values.end(); ++iter)
+  {
+    DefaultMinimizerIndex::minimizer_type minimizer = get_minimizer(iter->first);
+    std::vector<std::pair<pos_t, payload_type>> result = this->mi.find(minimizer);
+    ASSERT_EQ(result.size(), iter->second.size()) << "Wrong number of positions for key " << iter->first;
+    auto correct_iter = iter->second.begin();
+    for(size_t i = 0; i < result.size(); i++, ++correct_iter)
+    {
+      const pos_t& pos = result[i].first;
+      const payload_type& payload = result[i].second;
+      EXPECT_EQ(pos, correct_iter->first) << "Wrong position " << i << " for key " << iter->first;
+      EXPECT_EQ(payload.first, correct_iter->second.first) << "Wrong payload " << i << " for key " << iter->first;
+      EXPECT_GE(payload.haplotypes(), size_t(1)) << "No haplotypes for position " << i << " of key " << iter->first;
+      EXPECT_LE(payload.haplotypes(), max_haplotypes) << "Too many haplotypes for position " << i << " of key " << iter->first;
+      if(id(pos) == 2 || id(pos) == 8)
+      {
+        EXPECT_EQ(payload.haplotypes(), size_t(1)) << "Wrong haplotype count for position " << i << " of key " << iter->first;
+      }
+    }
+
+    // Threshold filter.
+    EXPECT_EQ(this->mi.find(minimizer, 0), result) << "Threshold 0 removed hits for key " << iter->first;
+    EXPECT_TRUE(this->mi.find(minimizer, max_haplotypes + 1).empty()) << "Threshold " << (max_haplotypes + 1) << " did not remove all hits for key " << iter->first;
+  }
+}
+
+TEST(HaplotypeCountGrouping, SameOffsetDifferentKeys)
+{
+  typedef DefaultMinimizerIndex::key_type key_type;
+  typedef DefaultMinimizerIndex::minimizer_type minimizer_type;
+  typedef std::pair<gbwt::node_type, size_t> window_type;
+
+  // Two minimizers with the same offset and orientation are equivalent in the default
+  // order, so sorting by (hit, window) would interleave the windows of the keys.
+  minimizer_type first = get_minimizer<key_type>(1, 5), second = get_minimizer<key_type>(2, 5);
+  pos_t pos = make_pos_t(1, false, 0);
+  std::vector<std::pair<std::pair<minimizer_type, pos_t>, window_type>> cache =
+  {
+    { { first, pos }, window_type(4, 3) },
+    { { second, pos }, window_type(2, 2) },
+    { { first, pos }, window_type(2, 3) },
+    { { first, pos }, window_type(2, 1) },
+  };
+
+  std::vector<std::pair<std::pair<minimizer_type, pos_t>, size_t>> hits = count_window_haplotypes(cache);
+  ASSERT_EQ(hits.size(), size_t(2)) << "Wrong number of distinct hits";
+  for(auto& hit : hits)
+  {
+    EXPECT_EQ(hit.first.second, pos) << "Wrong position for key " << hit.first.first.key;
+    if(hit.first.first == first)
+    {
+      EXPECT_EQ(hit.second, size_t(4)) << "Wrong haplotype count for the first key";
+    }
+    else
+    {
+      EXPECT_EQ(hit.first.first, second) << "Unexpected minimizer with key " << hit.first.first.key;
+      EXPECT_EQ(hit.second, size_t(2)) << "Wrong haplotype count for the second key";
+    }
+  }
+}
+
+TEST_F(IndexConstruction, AddHaplotypes)
+{
+  auto get_payload = [](const pos_t& pos) -> payload_type
+  {
+    return payload_type::create(hash(pos));
+  };
+
+  // Path 0 is short_path.
+  std::map<DefaultMinimizerIndex::key_type, std::set<std::pair<pos_t, payload_type>>> correct_values;
+  this->insert_values(short_path, correct_values);
+  add_haplotypes(this->graph, this->mi, { 0 }, get_payload);
+  this->check_minimizer_index(correct_values);
+
+  // Path 1 is alt_path and path 2 is short_path.
+  this->insert_values(alt_path, correct_values);
+  add_haplotypes(this->graph, this->mi, { 1, 2 }, get_payload);
+  this->check_minimizer_index(correct_values);
+}
+
+TEST_F(IndexConstruction, AddHaplotypesWithCounts)
+{
+  ASSERT_TRUE(this->mi.use_haplotype_counts()) << "Could not enable haplotype counts";
+  add_haplotypes(this->graph, this->mi, { 0, 1 }, [](const pos_t& pos) -> payload_type
+  {
+    return payload_type::create(hash(pos));
+  });
+  add_haplotypes(this->graph, this->mi, { 2 }, [](const pos_t& pos) -> payload_type
+  {
+    return payload_type::create(hash(pos));
+  });
+
+  // Nodes 2 and 8 are only on alt_path, while node 7 is on both copies of short_path.
+  std::map<DefaultMinimizerIndex::key_type, std::set<std::pair<pos_t, payload_type>>> correct_values;
+  this->insert_values(alt_path, correct_values);
+  this->insert_values(short_path, correct_values);
+  for(auto iter = correct_values.begin(); iter != correct_values.end(); ++iter)
+  {
+    std::vector<std::pair<pos_t, payload_type>> result = this->mi.find(get_minimizer(iter->first));
+    ASSERT_EQ(result.size(), iter->second.size()) << "Wrong number of positions for key " << iter->first;
+    for(size_t i = 0; i < result.size(); i++)
+    {
+      const pos_t& pos = result[i].first;
+      size_t haplotypes = result[i].second.haplotypes();
+      EXPECT_GE(haplotypes, size_t(1)) << "No haplotypes for position " << i << " of key " << iter->first;
+      EXPECT_LE(haplotypes, size_t(3)) << "Too many haplotypes for position " << i << " of key " << iter->first;
+      if(id(pos) == 2 || id(pos) == 8)
+      {
+        EXPECT_EQ(haplotypes, size_t(1)) << "Wrong haplotype count for position " << i << " of key " << iter->first;
+      }
+      if(id(pos) == 7)
+      {
+        EXPECT_EQ(haplotypes, size_t(2)) << "Wrong haplotype count for position " << i << " of key " << iter->first;
+      }
+    }
+  }
+}
+
 //------------------------------------------------------------------------------
 
 } // namespace
@@ -0,0 +1,149 @@
+#include <gtest/gtest.h>
+
+#include <fstream>
+#include <map>
+#include <vector>
+
+#include <gbwtgraph/kmer.h>
+
+#include "shared.h"
+
+using namespace gbwtgraph;
+
+namespace
+{
+
+//------------------------------------------------------------------------------
+
+template<class KeyType>
+class KmerCounting : public ::testing::Test
+{
+public:
+  typedef std::map<KeyType, std::uint64_t> result_type;
+
+  gbwt::GBWT index;
+  SequenceSource source;
+  GBWTGraph graph;
+
+  void SetUp() override
+  {
+    this->index = build_gbwt_index();
+    build_source(this->source);
+    this->graph = GBWTGraph(this->index, this->source);
+  }
+
+  void count_kmers(const std::string& seq, size_t k, bool canonical, result_type& result) const
+  {
+    for(size_t i = 0; i + k <= seq.length(); i++)
+    {
+      std::string kmer = seq.substr(i, k);
+      KeyType key = KeyType::encode(kmer);
+      if(canonical) { key = std::min(key, KeyType::encode(reverse_complement(kmer))); }
+      result[key]++;
+    }
+  }
+
+  // Count the kmers directly from the haplotype sequences.
+  result_type correct_counts(size_t k, bool canonical) const
+  {
+    result_type result;
+    for(gbwt::size_type path_id = 0; path_id < this->index.sequences() / 2; path_id++)
+    {
+      std::string seq;
+      for(gbwt::node_type node : this->index.extract(gbwt::Path::encode(path_id, false)))
+      {
+        seq += this->graph.get_sequence(GBWTGraph::node_to_handle(node));
+      }
+      this->count_kmers(seq, k, canonical, result);
+      if(!canonical) { this->count_kmers(reverse_complement(seq), k, canonical, result); }
+    }
+    return result;
+  }
+
+  void check_table(const KmerTable<KeyType>& table, const result_type& truth, size_t k, bool canonical) const
+  {
+    ASSERT_EQ(table.k(), k) << "Invalid kmer length";
+    ASSERT_EQ(table.canonical(), canonical) << "Invalid canonical flag";
+    ASSERT_EQ(table.size(), truth.size()) << "Invalid number of kmers with k = " << k;
+    ASSERT_EQ(table.counts.size(), truth.size()) << "Invalid number of counts with k = " << k;
+    ASSERT_EQ(table.header.kmers, truth.size()) << "Invalid number of kmers in the header";
+    size_t i = 0, total = 0;
+    for(auto iter = truth.begin(); iter != truth.end(); ++iter, i++)
+    {
+      EXPECT_EQ(table.keys[i], iter->first) << "Invalid key " << i << " with k = " << k;
+      EXPECT_EQ(table.counts[i], iter->second) << "Invalid count for kmer " << iter->first.decode(k);
+      EXPECT_EQ(table.count(iter->first), iter->second) << "Invalid count from the query for kmer " << iter->first.decode(k);
+      total += iter->second;
+    }
+    EXPECT_EQ(table.total_count(), total) << "Invalid total count with k = " << k;
+  }
+};
+
+typedef ::testing::Types<Key64, Key128> KeyTypes;
+TYPED_TEST_CASE(KmerCounting, KeyTypes);
+
+TYPED_TEST(KmerCounting, Canonical)
+{
+  for(size_t k : { 1, 2, 3, 4, 5 })
+  {
+    KmerTable<TypeParam> table = count_haplotype_kmers<TypeParam>(this->graph, k, true);
+    auto truth = this->correct_counts(k, true);
+    this->check_table(table, truth, k, true);
+  }
+}
+
+TYPED_TEST(KmerCounting, BothOrientations)
+{
+  for(size_t k : { 1, 2, 3, 4, 5 })
+  {
+    KmerTable<TypeParam> table = count_haplotype_kmers<TypeParam>(this->graph, k, false);
+    auto truth = this->correct_counts(k, false);
+    this->check_table(table, truth, k, false);
+  }
+}
+
+TYPED_TEST(KmerCounting, StringQueries)
+{
+  size_t k = 4;
+  KmerTable<TypeParam> table = count_haplotype_kmers<TypeParam>(this->graph, k, true);
+  auto truth = this->correct_counts(k, true);
+  for(auto iter = truth.begin(); iter != truth.end(); ++iter)
+  {
+    std::string kmer = iter->first.decode(k);
+    EXPECT_EQ(table.count(kmer), iter->second) << "Invalid count for kmer " << kmer;
+    EXPECT_EQ(table.count(reverse_complement(kmer)), iter->second) << "Invalid count for the reverse complement of " << kmer;
+  }
+  EXPECT_EQ(table.count(std::string("CCCC")), 0u) << "Found a count for a missing kmer";
+  EXPECT_EQ(table.count(std::string("GGN")), 0u) << "Found a count for a kmer of the wrong length";
+  EXPECT_EQ(table.count(std::string("GGNG")), 0u) << "Found a count for an invalid kmer";
+}
+
+TYPED_TEST(KmerCounting, Serialization)
+{
+  KmerTable<TypeParam> original = count_haplotype_kmers<TypeParam>(this->graph, 3, true);
+  std::string filename = gbwt::TempFile::getName("kmer");
+  std::ofstream out(filename, std::ios_base::binary);
+  auto result = original.serialize(out);
+  out.close();
+  ASSERT_TRUE(result.second) << "Serialization failed";
+
+  KmerTable<TypeParam> loaded;
+  std::ifstream in(filename, std::ios_base::binary);
+  size_t bytes = gbwt::fileSize(in);
+  ASSERT_EQ(bytes, result.first) << "Invalid file size";
+  ASSERT_TRUE(loaded.deserialize(in)) << "Loading failed";
+  in.close();
+  EXPECT_EQ(loaded, original) << "The loaded table is not identical to the original";
+
+  gbwt::TempFile::remove(filename);
+}
+
+TYPED_TEST(KmerCounting, InvalidLength)
+{
+  EXPECT_THROW(count_haplotype_kmers<TypeParam>(this->graph, 0, true), std::runtime_error);
+  EXPECT_THROW(count_haplotype_kmers<TypeParam>(this->graph, TypeParam::KMER_MAX_LENGTH + 1, true), std::runtime_error);
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace
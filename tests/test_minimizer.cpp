@@ -2,6 +2,7 @@
 
 #include <algorithm>
 #include <fstream>
+#include <iterator>
 #include <map>
 #include <random>
 #include <set>
@@ -108,6 +109,53 @@ TYPED_TEST(ObjectManipulation, Serialization)
   EXPECT_EQ(index, copy) << "Loaded index is not identical to the original";
 }
 
+TYPED_TEST(ObjectManipulation, ParallelSerialization)
+{
+  // Use enough keys for multiple blocks and some keys with multiple occurrences.
+  MinimizerIndex<TypeParam> index(15, 6);
+  size_t keys = 2 * MinimizerIndex<TypeParam>::PARALLEL_BLOCK_SIZE;
+  for(size_t i = 1; i <= keys; i++)
+  {
+    size_t occurrences = (i % 7 == 0 ? 3 : 1);
+    for(size_t j = 1; j <= occurrences; j++)
+    {
+      index.insert(get_minimizer<TypeParam>(i), make_pos_t(j, false, i & Position::OFF_MASK), payload_type::create(hash(j, false, i)));
+    }
+  }
+  ASSERT_GT(index.capacity(), MinimizerIndex<TypeParam>::PARALLEL_BLOCK_SIZE) << "The hash table is too small for multiple blocks";
+
+  // Parallel serialization, normal loading.
+  std::string parallel_file = gbwt::TempFile::getName("minimizer");
+  ASSERT_TRUE(index.parallel_serialize(parallel_file)) << "Parallel serialization failed";
+  {
+    MinimizerIndex<TypeParam> copy;
+    std::ifstream in(parallel_file, std::ios_base::binary);
+    ASSERT_TRUE(copy.deserialize(in)) << "Loading a parallel serialized index failed";
+    in.close();
+    EXPECT_EQ(index, copy) << "Loaded index is not identical to the original";
+  }
+
+  // Normal serialization, parallel loading.
+  std::string normal_file = gbwt::TempFile::getName("minimizer");
+  std::ofstream out(normal_file, std::ios_base::binary);
+  index.serialize(out);
+  out.close();
+  {
+    MinimizerIndex<TypeParam> copy;
+    ASSERT_TRUE(copy.parallel_deserialize(normal_file)) << "Parallel loading failed";
+    EXPECT_EQ(index, copy) << "Loaded index is not identical to the original";
+  }
+
+  // The files should be identical.
+  std::ifstream parallel_in(parallel_file, std::ios_base::binary), normal_in(normal_file, std::ios_base::binary);
+  std::string parallel_bytes((std::istreambuf_iterator<char>(parallel_in)), std::istreambuf_iterator<char>());
+  std::string normal_bytes((std::istreambuf_iterator<char>(normal_in)), std::istreambuf_iterator<char>());
+  EXPECT_EQ(parallel_bytes, normal_bytes) << "Parallel and normal serialization produce different files";
+
+  gbwt::TempFile::remove(parallel_file);
+  gbwt::TempFile::remove(normal_file);
+}
+
 //------------------------------------------------------------------------------
 
 template<class KeyType>
@@ -556,6 +604,46 @@ TYPED_TEST(MinimizerExtraction, BothOrientations)
   }
 }
 
+TYPED_TEST(MinimizerExtraction, BatchMinimizers)
+{
+  // Random reads of various lengths with some invalid characters and low-complexity regions.
+  std::vector<std::string> reads;
+  std::mt19937_64 rng(0xDEADBEEF);
+  std::string alphabet = "ACGTACGTACGTACGTN";
+  for(size_t i = 0; i < 200; i++)
+  {
+    size_t length = rng() % 300;
+    std::string read;
+    for(size_t j = 0; j < length; j++)
+    {
+      if(rng() % 20 == 0) { read += this->repetitive; }
+      else { read += alphabet[rng() % alphabet.length()]; }
+    }
+    reads.push_back(read);
+  }
+  reads.push_back(this->str);
+  reads.push_back(this->rev);
+  reads.push_back("");
+
+  std::vector<MinimizerIndex<TypeParam>> indexes;
+  indexes.emplace_back(3, 2);
+  indexes.emplace_back(TypeParam::KMER_LENGTH, TypeParam::WINDOW_LENGTH);
+  indexes.emplace_back(TypeParam::KMER_LENGTH, TypeParam::SMER_LENGTH, true);
+  for(const MinimizerIndex<TypeParam>& index : indexes)
+  {
+    std::vector<size_t> offsets;
+    std::vector<typename MinimizerIndex<TypeParam>::minimizer_type> result = index.minimizers(reads, offsets);
+    ASSERT_EQ(offsets.size(), reads.size() + 1) << "Invalid number of offsets with k " << index.k() << ", w " << index.w();
+    ASSERT_EQ(offsets.back(), result.size()) << "Invalid final offset with k " << index.k() << ", w " << index.w();
+    for(size_t i = 0; i < reads.size(); i++)
+    {
+      std::vector<typename MinimizerIndex<TypeParam>::minimizer_type> correct = index.minimizers(reads[i]);
+      std::vector<typename MinimizerIndex<TypeParam>::minimizer_type> found(result.begin() + offsets[i], result.begin() + offsets[i + 1]);
+      EXPECT_EQ(found, correct) << "Invalid minimizers for read " << i << " with k " << index.k() << ", w " << index.w();
+    }
+  }
+}
+
 //------------------------------------------------------------------------------
 
 template<class KeyType>
@@ -788,6 +876,29 @@ public:
       result.emplace_back(pos, payload);
     });
     ASSERT_EQ(result, expected_result) << test_case << ": Incorrect results with exponential search";
+
+    SubgraphBitmap bitmap(subgraph);
+    result.clear();
+    hits_in_subgraph(hits.size(), hits.data(), bitmap, [&](pos_t pos, payload_type payload)
+    {
+      result.emplace_back(pos, payload);
+    });
+    ASSERT_EQ(result, expected_result) << test_case << ": Incorrect results with a bitmap";
+
+    // Versions using std::function.
+    std::function<void(pos_t, payload_type)> report_hit = [&](pos_t pos, payload_type payload)
+    {
+      result.emplace_back(pos, payload);
+    };
+    result.clear();
+    hits_in_subgraph(hits.size(), hits.data(), subgraph, report_hit);
+    ASSERT_EQ(result, expected_result) << test_case << ": Incorrect results with the naive algorithm (std::function)";
+    result.clear();
+    hits_in_subgraph(hits.size(), hits.data(), sorted_subgraph, report_hit);
+    ASSERT_EQ(result, expected_result) << test_case << ": Incorrect results with exponential search (std::function)";
+    result.clear();
+    hits_in_subgraph(hits.size(), hits.data(), bitmap, report_hit);
+    ASSERT_EQ(result, expected_result) << test_case << ": Incorrect results with a bitmap (std::function)";
   }
 
   std::tuple<std::unordered_set<nid_t>, std::vector<hit_type>, result_type>
@@ -896,6 +1007,47 @@ TEST_F(HitsInSubgraphTest, LargeSets)
   }
 }
 
+TEST_F(HitsInSubgraphTest, SimilarSizes)
+{
+  // The subgraph and the hits cover most of the universe, so the lists are merged.
+  constexpr size_t UNIVERSE_SIZE = 4096;
+  constexpr size_t INTERVALS = 5;
+  constexpr double INTERVAL_PROB = 0.5;
+  constexpr double OUTLIER_PROB = 0.3;
+  constexpr double HIT_PROB = 0.6;
+
+  for(size_t i = 1; i <= INTERVALS; i++)
+  {
+    std::unordered_set<nid_t> subgraph;
+    std::vector<hit_type> hits;
+    result_type expected_result;
+    size_t random_seed = i * 0xDEADBEEF;
+    std::tie(subgraph, hits, expected_result) =
+      this->create_test_case(UNIVERSE_SIZE, 0, UNIVERSE_SIZE / 2, INTERVAL_PROB, OUTLIER_PROB, HIT_PROB, random_seed);
+    this->check_results(subgraph, hits, expected_result, "Set " + std::to_string(i));
+  }
+}
+
+TEST(SubgraphBitmap, Density)
+{
+  std::vector<nid_t> subgraph { 10, 12, 13, 20 };
+  SubgraphBitmap bitmap(subgraph);
+  EXPECT_EQ(bitmap.universe(), size_t(11)) << "Invalid universe size";
+  for(nid_t id = 0; id < 25; id++)
+  {
+    bool truth = std::find(subgraph.begin(), subgraph.end(), id) != subgraph.end();
+    EXPECT_EQ(bitmap.contains(id), truth) << "Invalid membership for node " << id;
+  }
+
+  SubgraphBitmap empty;
+  EXPECT_TRUE(empty.empty()) << "Default bitmap is not empty";
+  EXPECT_FALSE(empty.contains(0)) << "Empty bitmap contains a node";
+
+  EXPECT_TRUE(SubgraphBitmap::is_dense(4, 10, 20)) << "A small interval is not dense";
+  EXPECT_FALSE(SubgraphBitmap::is_dense(2, 1, 1000000)) << "A sparse subgraph is dense";
+  EXPECT_FALSE(SubgraphBitmap::is_dense(0, 1, 1)) << "An empty subgraph is dense";
+}
+
 //------------------------------------------------------------------------------
 
 } // namespace
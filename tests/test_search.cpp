@@ -0,0 +1,239 @@
+#include <gtest/gtest.h>
+
+#include <algorithm>
+#include <map>
+#include <vector>
+
+#include <gbwtgraph/index.h>
+#include <gbwtgraph/search.h>
+
+#include "shared.h"
+
+using namespace gbwtgraph;
+
+namespace
+{
+
+//------------------------------------------------------------------------------
+
+class SequenceSearch : public ::testing::Test
+{
+public:
+  // (path as GBWT nodes, offset) -> haplotype occurrences
+  typedef std::map<std::pair<std::vector<gbwt::node_type>, size_t>, size_t> result_type;
+
+  gbwt::GBWT index;
+  SequenceSource source;
+  GBWTGraph graph;
+  DefaultMinimizerIndex mi;
+
+  std::vector<std::string> queries
+  {
+    "G", "GGG", "GTA", "GGGTA", "TACA", "GAGGGTAAA", "TGTACCCC", "AAA", "CCC", "GGGGG", "TACAT"
+  };
+
+  SequenceSearch() :
+    mi(3, 2)
+  {
+  }
+
+  void SetUp() override
+  {
+    this->index = build_gbwt_index();
+    build_source(this->source);
+    this->graph = GBWTGraph(this->index, this->source);
+    index_haplotypes(this->graph, this->mi, [](const pos_t&) -> payload_type
+    {
+      return DefaultMinimizerIndex::DEFAULT_PAYLOAD;
+    });
+  }
+
+  // Find the occurrences by scanning all haplotypes in both orientations.
+  result_type correct_matches(const std::string& query) const
+  {
+    result_type result;
+    for(gbwt::size_type sequence = 0; sequence < this->index.sequences(); sequence++)
+    {
+      gbwt::vector_type path = this->index.extract(sequence);
+      std::string seq;
+      std::vector<std::pair<size_t, size_t>> node_at; // (path offset, node offset) for each base.
+      for(size_t i = 0; i < path.size(); i++)
+      {
+        std::string node_seq = this->graph.get_sequence(GBWTGraph::node_to_handle(path[i]));
+        for(size_t j = 0; j < node_seq.length(); j++) { node_at.emplace_back(i, j); }
+        seq += node_seq;
+      }
+      for(size_t start = seq.find(query); start != std::string::npos; start = seq.find(query, start + 1))
+      {
+        size_t first = node_at[start].first, last = node_at[start + query.length() - 1].first;
+        std::vector<gbwt::node_type> nodes(path.begin() + first, path.begin() + last + 1);
+        result[std::make_pair(nodes, node_at[start].second)]++;
+      }
+    }
+    return result;
+  }
+
+  void check_matches(const std::vector<SequenceMatch>& matches, const std::string& query, const std::string& method) const
+  {
+    result_type truth = this->correct_matches(query);
+    ASSERT_EQ(matches.size(), truth.size()) << "Invalid number of matches for " << query << " with " << method;
+    for(const SequenceMatch& match : matches)
+    {
+      std::vector<gbwt::node_type> nodes;
+      for(handle_t handle : match.path) { nodes.push_back(GBWTGraph::handle_to_node(handle)); }
+      auto iter = truth.find(std::make_pair(nodes, match.offset));
+      ASSERT_TRUE(iter != truth.end()) << "Invalid match for " << query << " at offset " << match.offset << " with " << method;
+      EXPECT_EQ(match.haplotypes(), iter->second) << "Invalid haplotype count for " << query << " at offset " << match.offset << " with " << method;
+      gbwt::BidirectionalState expected = this->graph.bd_find(match.path);
+      EXPECT_TRUE(match.state.forward == expected.forward && match.state.backward == expected.backward) << "Invalid search state for " << query << " with " << method;
+    }
+    EXPECT_TRUE(std::is_sorted(matches.begin(), matches.end())) << "Matches for " << query << " are not sorted with " << method;
+  }
+};
+
+TEST_F(SequenceSearch, WithoutIndex)
+{
+  gbwt::CachedGBWT cache = this->graph.get_cache();
+  for(const std::string& query : this->queries)
+  {
+    std::vector<SequenceMatch> matches = find_haplotype_matches(this->graph, cache, query);
+    this->check_matches(matches, query, "index-free search");
+  }
+}
+
+TEST_F(SequenceSearch, WithMinimizers)
+{
+  for(const std::string& query : this->queries)
+  {
+    std::vector<SequenceMatch> matches = find_haplotype_matches(this->graph, this->mi, query);
+    this->check_matches(matches, query, "minimizer seeds");
+  }
+}
+
+TEST_F(SequenceSearch, Batch)
+{
+  std::vector<std::vector<SequenceMatch>> with_index = find_haplotype_matches(this->graph, this->mi, this->queries);
+  std::vector<std::vector<SequenceMatch>> without_index = find_haplotype_matches(this->graph, this->queries);
+  ASSERT_EQ(with_index.size(), this->queries.size()) << "Invalid number of results with minimizer seeds";
+  ASSERT_EQ(without_index.size(), this->queries.size()) << "Invalid number of results without an index";
+  for(size_t i = 0; i < this->queries.size(); i++)
+  {
+    this->check_matches(with_index[i], this->queries[i], "batch minimizer seeds");
+    this->check_matches(without_index[i], this->queries[i], "batch index-free search");
+  }
+}
+
+TEST_F(SequenceSearch, InvalidAnchors)
+{
+  gbwt::CachedGBWT cache = this->graph.get_cache();
+  std::vector<SequenceMatch> output;
+  extend_anchor(this->graph, cache, "GGG", 0, make_pos_t(3, false, 0), output); // Not in the graph.
+  extend_anchor(this->graph, cache, "GGG", 0, make_pos_t(4, false, 3), output); // Offset past the end.
+  extend_anchor(this->graph, cache, "GGG", 3, make_pos_t(4, false, 0), output); // Query offset past the end.
+  extend_anchor(this->graph, cache, "", 0, make_pos_t(4, false, 0), output); // Empty query.
+  extend_anchor(this->graph, cache, "GGG", 0, make_pos_t(5, false, 0), output); // Mismatch.
+  EXPECT_TRUE(output.empty()) << "Found matches from invalid anchors";
+}
+
+//------------------------------------------------------------------------------
+
+class PathQueries : public ::testing::Test
+{
+public:
+  gbwt::GBWT index;
+  SequenceSource source;
+  GBWTGraph graph;
+
+  std::vector<std::vector<handle_t>> paths;
+
+  void SetUp() override
+  {
+    this->index = build_gbwt_index();
+    build_source(this->source);
+    this->graph = GBWTGraph(this->index, this->source);
+
+    // All subpaths of the haplotypes in both orientations, with duplicates.
+    for(gbwt::size_type sequence = 0; sequence < this->index.sequences(); sequence++)
+    {
+      gbwt::vector_type path = this->index.extract(sequence);
+      for(size_t start = 0; start < path.size(); start++)
+      {
+        for(size_t limit = start + 1; limit <= path.size(); limit++)
+        {
+          std::vector<handle_t> subpath;
+          for(size_t i = start; i < limit; i++) { subpath.push_back(GBWTGraph::node_to_handle(path[i])); }
+          this->paths.push_back(subpath);
+        }
+      }
+    }
+
+    // An empty path, paths with no occurrences, and a path with an invalid node.
+    this->paths.push_back({ });
+    this->paths.push_back({ this->graph.get_handle(1, false), this->graph.get_handle(5, false) });
+    this->paths.push_back({ this->graph.get_handle(1, false), this->graph.get_handle(2, false), this->graph.get_handle(1, false) });
+    this->paths.push_back({ this->graph.get_handle(1, false), GBWTGraph::node_to_handle(gbwt::Node::encode(100, false)) });
+  }
+
+  // Find the sequence identifiers of the occurrences by scanning the haplotypes.
+  std::vector<gbwt::size_type> correct_occurrences(const std::vector<handle_t>& path) const
+  {
+    std::vector<gbwt::size_type> result;
+    if(path.empty()) { return result; }
+    for(gbwt::size_type sequence = 0; sequence < this->index.sequences(); sequence++)
+    {
+      gbwt::vector_type haplotype = this->index.extract(sequence);
+      for(size_t start = 0; start + path.size() <= haplotype.size(); start++)
+      {
+        bool found = true;
+        for(size_t i = 0; i < path.size(); i++)
+        {
+          if(haplotype[start + i] != GBWTGraph::handle_to_node(path[i])) { found = false; break; }
+        }
+        if(found) { result.push_back(sequence); }
+      }
+    }
+    return result;
+  }
+};
+
+TEST_F(PathQueries, SearchStates)
+{
+  std::vector<gbwt::SearchState> states = find_paths(this->graph, this->paths);
+  ASSERT_EQ(states.size(), this->paths.size()) << "Invalid number of search states";
+  for(size_t i = 0; i < this->paths.size(); i++)
+  {
+    gbwt::SearchState expected = this->graph.find(this->paths[i]);
+    EXPECT_EQ(states[i], expected) << "Invalid search state for path " << i;
+  }
+}
+
+TEST_F(PathQueries, HaplotypeCounts)
+{
+  std::vector<size_t> counts = count_haplotypes(this->graph, this->paths);
+  ASSERT_EQ(counts.size(), this->paths.size()) << "Invalid number of counts";
+  for(size_t i = 0; i < this->paths.size(); i++)
+  {
+    EXPECT_EQ(counts[i], this->correct_occurrences(this->paths[i]).size()) << "Invalid haplotype count for path " << i;
+  }
+}
+
+TEST_F(PathQueries, HaplotypeIdentifiers)
+{
+  std::vector<std::vector<gbwt::size_type>> occurrences = locate_haplotypes(this->graph, this->paths);
+  ASSERT_EQ(occurrences.size(), this->paths.size()) << "Invalid number of results";
+  for(size_t i = 0; i < this->paths.size(); i++)
+  {
+    EXPECT_EQ(occurrences[i], this->correct_occurrences(this->paths[i])) << "Invalid occurrences for path " << i;
+  }
+}
+
+TEST_F(PathQueries, EmptyBatch)
+{
+  std::vector<std::vector<handle_t>> empty;
+  EXPECT_TRUE(find_paths(this->graph, empty).empty()) << "Found search states for an empty batch";
+  EXPECT_TRUE(count_haplotypes(this->graph, empty).empty()) << "Found counts for an empty batch";
+}
+
+//------------------------------------------------------------------------------
+
+} // namespace
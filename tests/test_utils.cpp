@@ -1,5 +1,7 @@
 #include <gtest/gtest.h>
 
+#include <algorithm>
+
 #include <gbwtgraph/utils.h>
 
 #include "shared.h"
@@ -169,4 +171,84 @@ TEST_F(SourceTest, TranslateSegments)
 
 //------------------------------------------------------------------------------
 
+class ReverseComplementTest : public ::testing::Test
+{
+public:
+  // Reverse complement one character at a time.
+  std::string naive_reverse_complement(const std::string& seq) const
+  {
+    std::string result;
+    for(size_t i = seq.length(); i > 0; i--)
+    {
+      result += reverse_complement(std::string(1, seq[i - 1]));
+    }
+    return result;
+  }
+
+  void check(const std::string& seq, const std::string& test_case) const
+  {
+    std::string correct = this->naive_reverse_complement(seq);
+
+    EXPECT_EQ(reverse_complement(seq), correct) << test_case << ": Invalid reverse complement";
+
+    std::string in_place = seq;
+    reverse_complement_in_place(in_place);
+    EXPECT_EQ(in_place, correct) << test_case << ": Invalid in-place reverse complement";
+
+    std::vector<char> buffer(seq.length());
+    reverse_complement(seq.data(), seq.length(), buffer.data());
+    EXPECT_EQ(std::string(buffer.begin(), buffer.end()), correct) << test_case << ": Invalid reverse complement into a buffer";
+
+    std::string output = "garbage";
+    reverse_complement(get_view(seq), output);
+    EXPECT_EQ(output, correct) << test_case << ": Invalid reverse complement of a view";
+  }
+};
+
+TEST_F(ReverseComplementTest, Characters)
+{
+  std::string bases = "ACGTN", complements = "TGCAN";
+  for(size_t i = 0; i < bases.length(); i++)
+  {
+    EXPECT_EQ(reverse_complement(bases.substr(i, 1)), complements.substr(i, 1)) << "Invalid complement for " << bases[i];
+  }
+
+  std::string iupac = "ACGTUBDHKMRSVWYNacgtubdhkmrsvwyn$#-";
+  std::string correct = "-$#nrsbwykmdhvaacgtNRSBWYKMDHVAACGT";
+  std::string twice = "ACGTTBDHKMRSVWYNacgttbdhkmrsvwyn$#-"; // U becomes T.
+  EXPECT_EQ(reverse_complement(iupac), correct) << "Invalid reverse complement for IUPAC codes";
+  EXPECT_EQ(reverse_complement(correct), twice) << "Invalid reverse complement of reverse complement";
+}
+
+TEST_F(ReverseComplementTest, AllLengths)
+{
+  // All byte values at various lengths to cover the vectorized and scalar parts.
+  std::string all_chars;
+  for(size_t c = 0; c < 256; c++) { all_chars.push_back(static_cast<char>(c)); }
+  for(size_t length = 0; length <= 2 * all_chars.length(); length++)
+  {
+    std::string seq;
+    for(size_t i = 0; i < length; i++) { seq.push_back(all_chars[(7 * i) % all_chars.length()]); }
+    this->check(seq, "Length " + std::to_string(length));
+  }
+}
+
+//------------------------------------------------------------------------------
+
+TEST(HugePages, Advice)
+{
+  EXPECT_EQ(advise_huge_pages(nullptr, 4 * HUGE_PAGE_SIZE), 0u) << "Advice for a null pointer";
+
+  std::vector<char> small(HUGE_PAGE_SIZE / 2, 'A');
+  EXPECT_EQ(advise_huge_pages(small.data(), small.size()), 0u) << "Advice for a region smaller than a huge page";
+
+  std::vector<char> large(4 * HUGE_PAGE_SIZE, 'A');
+  size_t bytes = advise_huge_pages(large.data(), large.size());
+  EXPECT_EQ(bytes % HUGE_PAGE_SIZE, 0u) << "The advice does not cover whole huge pages";
+  EXPECT_LE(bytes, large.size()) << "The advice covers more than the region";
+  EXPECT_TRUE(std::all_of(large.begin(), large.end(), [](char c) { return (c == 'A'); })) << "The advice changed the contents";
+}
+
+//------------------------------------------------------------------------------
+
 } // namespace